@@ -0,0 +1,2946 @@
+/*
+   wavegen.c
+   Waveform Generator core (libwavegen)
+
+   Everything declared in wavegen.h. Nothing here reads or writes files
+   or the terminal: results come back through return values, the arena's
+   on_fail hook and the self-check's report callback, so the same object
+   links into a host program or a firmware image.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // clock_gettime, pthreads, sysconf
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wavegen.h"
+
+/* ---------- Library Context ---------- */
+
+// One-time setup of the read-only tables and the kernel choice; call
+// before anything renders
+void wavegen_init(void)
+{
+    sine_lut_init();
+#if WAVEGEN_FIXED_POINT
+    q15_sine_init();
+#endif
+#if WAVEGEN_STATS
+    stats_init();
+#endif
+    kernels_init();
+}
+
+// Context over bytes of caller memory, e.g. a static buffer of
+// WAVEGEN_ARENA_BYTES; nothing is allocated from it yet
+void wavegen_ctx_init(wavegen_ctx *ctx, void *mem, size_t bytes)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->scratch.base = (unsigned char *)mem;
+    ctx->scratch.cap = mem ? bytes : 0;
+}
+
+/* ---------- Input Parsing ---------- */
+
+/*
+   Command lines come in faster than scanf and sscanf can take them apart,
+   so these work in one pass over the caller's buffer: next_token cuts
+   tokens in place, the number parsers take a [s, end) range and never copy
+   it or look at the locale.
+*/
+
+// Next whitespace-separated token, NUL-terminated in place; NULL at the end
+// of the line or at a '#' comment
+char *next_token(char **cursor)
+{
+    char *p = *cursor;
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+    if (*p == '\0' || *p == '#') {
+        *cursor = p;
+        return NULL;
+    }
+    char *tok = p;
+    while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+    if (*p) *p++ = '\0';
+    *cursor = p;
+    return tok;
+}
+
+static const double pow10_exact[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Reads [+-]digits[.digits][e[+-]digits] from the start of [s, end).
+// Returns the end of the number, or NULL if there is none. Up to 15
+// significant digits with a power of ten within 1e+-22 round exactly
+// (one multiply or divide by an exact power); other inputs go through
+// long double and may be an ulp off.
+const char *parse_decimal(const char *s, const char *end, double *out)
+{
+    const char *p = s;
+    int neg = 0;
+    if (p < end && (*p == '+' || *p == '-')) neg = *p++ == '-';
+
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0, seen = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, seen = 1) {
+        if (digits < 19) {
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            digits += mant != 0;
+        } else {
+            exp10++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, seen = 1) {
+            if (digits < 19) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                digits += mant != 0;
+                exp10--;
+            }
+        }
+    }
+    if (!seen) return NULL;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0, e = 0;
+        if (q < end && (*q == '+' || *q == '-')) eneg = *q++ == '-';
+        if (q < end && *q >= '0' && *q <= '9') {
+            for (; q < end && *q >= '0' && *q <= '9'; q++) {
+                if (e < 10000) e = e * 10 + (*q - '0');
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    double v = (double)mant;
+    if (mant == 0) v = 0.0;
+    else if (exp10 >= 0 && exp10 <= 22 && mant <= (1ull << 53)) v *= pow10_exact[exp10];
+    else if (exp10 < 0 && exp10 >= -22 && mant <= (1ull << 53)) v /= pow10_exact[-exp10];
+    else v = (double)((long double)mant * powl(10.0L, exp10));
+    *out = neg ? -v : v;
+    return p;
+}
+
+// The whole of [s, end) as a number with an optional k, M or G suffix
+int parse_number_span(const char *s, const char *end, double *out)
+{
+    double v;
+    const char *p = parse_decimal(s, end, &v);
+    if (!p) return 0;
+    if (p < end) {
+        switch (*p) {
+            case 'k': case 'K': v *= 1e3; p++; break;
+            case 'M':           v *= 1e6; p++; break;
+            case 'G':           v *= 1e9; p++; break;
+            default: break;
+        }
+    }
+    if (p != end || !isfinite(v)) return 0;
+    *out = v;
+    return 1;
+}
+
+// Whole of [s, end) as a number, blanks around it allowed
+static int parse_number_trimmed(const char *s, const char *end, double *out)
+{
+    while (s < end && isspace((unsigned char)*s)) s++;
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    const char *p = parse_decimal(s, end, out);
+    return p && p == end && isfinite(*out);
+}
+
+// Phase in radians: "1.57", "3.14/2", "90deg", "90d", "d:90" or "r:1.57"
+int parse_phase_span(const char *s, const char *end, float *out_rad)
+{
+    while (s < end && isspace((unsigned char)*s)) s++;
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    double a, b;
+
+    if (end - s >= 2 && s[1] == ':' && (s[0] == 'r' || s[0] == 'R')) {
+        if (!parse_number_trimmed(s + 2, end, &a)) return 0;
+        *out_rad = (float)a;
+        return 1;
+    }
+    int degrees = 0;
+    if (end - s >= 2 && s[1] == ':' && (s[0] == 'd' || s[0] == 'D')) {
+        s += 2;
+        degrees = 1;
+    } else if (end - s >= 3 && memcmp(end - 3, "deg", 3) == 0) {
+        end -= 3;
+        degrees = 1;
+    } else if (end > s && (end[-1] == 'd' || end[-1] == 'D')) {
+        end--;
+        degrees = 1;
+    }
+    if (degrees) {
+        if (!parse_number_trimmed(s, end, &a)) return 0;
+        *out_rad = (float)(a * PI / 180.0f);
+        return 1;
+    }
+
+    const char *slash = memchr(s, '/', (size_t)(end - s));
+    if (slash) {
+        if (!parse_number_trimmed(s, slash, &a) || !parse_number_trimmed(slash + 1, end, &b) || b == 0.0)
+            return 0;
+        *out_rad = (float)(a / b);
+        return 1;
+    }
+    if (!parse_number_trimmed(s, end, &a)) return 0;
+    *out_rad = (float)a;
+    return 1;
+}
+
+// Parses user input for phase, supporting "90deg", "r:1.5", or fractions "3.14/2"
+int parse_phase_input_to_rad(const char *s_in, float *out_rad) {
+    if (!s_in || !out_rad) return 0;
+    return parse_phase_span(s_in, s_in + strlen(s_in), out_rad);
+}
+
+/* ---------- Settings ---------- */
+
+#define WAVE_DEFAULTS { 1.0f, 1.0f, 0.0f, 0.5f, 0, NULL }
+
+// The settings a new session starts from: 1 Hz, 1 V, 50 % duty everywhere
+void wave_settings_init(wave_settings *s)
+{
+    static const wave_settings defaults = {
+        { WAVE_DEFAULTS, WAVE_DEFAULTS, WAVE_DEFAULTS, WAVE_DEFAULTS, WAVE_DEFAULTS, WAVE_DEFAULTS },
+        1.0f, 0, "", AWG_LINEAR, 1
+    };
+    *s = defaults;
+}
+
+// Copy the current settings of one waveform out of a settings instance
+void wave_settings_get(const wave_settings *s, int waveform_type, wave_params *p)
+{
+    if (waveform_type >= 1 && waveform_type <= WAVE_AWG) {
+        *p = s->wave[waveform_type];
+    } else {
+        const wave_params none = { 0.0f, 0.0f, 0.0f, 0.5f, 0, NULL };
+        *p = none;
+    }
+    p->bandlimited = s->bandlimited;
+}
+
+/* ---------- ASCII Frames ---------- */
+
+// Renders a float array into a caller-provided character grid of
+// rows * (cols + 1) bytes. Returns the bytes used, or 0 if cap is too small.
+size_t render_ascii_frame(const float *yvals, int cols, int rows, float amp,
+                          char *frame, size_t cap)
+{
+    if (!yvals || !frame || cols <= 0 || rows <= 0) return 0;
+    const size_t stride = (size_t)cols + 1;
+    const size_t size = stride * (size_t)rows;
+    if (size > cap) return 0;
+
+    // Blank canvas, each row terminated by a newline
+    memset(frame, ' ', size);
+    for (int r = 0; r < rows; r++) frame[r * stride + (size_t)cols] = '\n';
+
+    // Draw the zero-crossing line (X-axis)
+    int mid_row = (int)(((amp - 0.0f) / (2.0f * (amp == 0.0f ? 1.0f : amp))) * (rows - 1) + 0.5f);
+    if (mid_row < 0) mid_row = 0;
+    if (mid_row >= rows) mid_row = rows - 1;
+    memset(frame + (size_t)mid_row * stride, '-', (size_t)cols);
+
+    // Map the Y values to the grid; points overwrite the axis
+    for (int c = 0; c < cols; c++) {
+        float y = yvals[c];
+        float frac = 0.5f; // Default center
+        
+        // Normalize y to 0..1 range based on amplitude
+        if (amp != 0.0f) frac = (amp - y) / (2.0f * amp); 
+        
+        if (frac < 0.0f) frac = 0.0f;
+        if (frac > 1.0f) frac = 1.0f;
+        
+        // Convert normalized fraction to row index
+        int row = (int)(frac * (rows - 1) + 0.5f);
+        if (row < 0) row = 0;
+        if (row >= rows) row = rows - 1;
+        
+        // Plot point
+        frame[(size_t)row * stride + (size_t)c] = '*';
+    }
+    return size;
+}
+
+/* ---------- Scratch Arena ---------- */
+
+void *arena_alloc(arena *a, size_t bytes)
+{
+    uintptr_t start = (uintptr_t)(a->base + a->used);
+    size_t pad = (size_t)((ARENA_ALIGN - start % ARENA_ALIGN) % ARENA_ALIGN);
+    if (bytes > a->cap - a->used || pad > a->cap - a->used - bytes) {
+        a->failed++;
+        if (a->on_fail) a->on_fail(a, bytes);
+        return NULL;
+    }
+    void *p = a->base + a->used + pad;
+    a->used += pad + bytes;
+    if (a->used > a->high) a->high = a->used;
+    return p;
+}
+
+size_t arena_mark(const arena *a)
+{
+    return a->used;
+}
+
+void arena_release(arena *a, size_t mark)
+{
+    if (mark < a->used) a->used = mark;
+}
+
+void arena_reset(arena *a)
+{
+    a->used = 0;
+}
+
+/* ---------- DDS Oscillator Core ---------- */
+
+// Maps any (possibly negative) number of cycles onto the 32-bit phase circle
+uint32_t dds_phase_from_cycles(double cycles)
+{
+    double frac = cycles - floor(cycles);
+    return (uint32_t)(uint64_t)(frac * DDS_TURN);
+}
+
+// Sets up an oscillator that starts start_cycles into its period
+void dds_init(dds_osc *o, double freq, double dt, double start_cycles)
+{
+    o->phase = dds_phase_from_cycles(start_cycles);
+    o->inc = dds_phase_from_cycles(freq * dt);
+}
+
+// Normalized time 0..1 from the top 24 bits of the phase (exact in a float)
+static inline float dds_pos(uint32_t phase)
+{
+    return (float)(phase >> 8) * (1.0f / 16777216.0f);
+}
+
+/* ---------- Sine Lookup Table ---------- */
+
+// Quarter wave sin(0 .. pi/2) inclusive, mirrored into the other three quadrants
+static float sine_qtab[SINE_LUT_QUARTER + 1];
+
+static void sine_lut_fill(float *q, int bits)
+{
+    int quarter = 1 << (bits - 2);
+    for (int k = 0; k <= quarter; k++)
+        q[k] = (float)sin(2.0 * 3.14159265358979323846 * k / (double)(1 << bits));
+}
+
+void sine_lut_init(void)
+{
+    sine_lut_fill(sine_qtab, SINE_LUT_BITS);
+}
+
+// sin(2*pi*phase/2^32) from a quarter table of 2^bits/4 + 1 entries.
+// interp: 1 = nearest entry, 2 = linear between neighbouring entries.
+static inline float sine_lut_eval(const float *q, int bits, int interp, uint32_t phase)
+{
+    const int shift = 32 - bits;
+    const uint32_t quarter = 1u << (bits - 2);
+
+    if (interp == 1) phase += 1u << (shift - 1); // Round to the nearest entry
+
+    uint32_t idx = phase >> shift;
+    uint32_t k = idx & (quarter - 1);
+    uint32_t quad = idx >> (bits - 2);
+
+    // Entries idx and idx + 1 read from the quarter table in mirror order
+    float a, b;
+    if (quad & 1) { a = q[quarter - k]; b = q[quarter - k - 1]; }
+    else          { a = q[k];           b = q[k + 1]; }
+
+    float y = a;
+    if (interp == 2) {
+        float frac = (float)(phase & ((1u << shift) - 1)) * (1.0f / (float)(1u << shift));
+        y = a + (b - a) * frac;
+    }
+    return (quad & 2) ? -y : y;
+}
+
+static inline float dds_sin(uint32_t phase)
+{
+#if SINE_LUT_INTERP == 0
+    return sinf(2.0f * PI * dds_pos(phase));
+#else
+    return sine_lut_eval(sine_qtab, SINE_LUT_BITS, SINE_LUT_INTERP, phase);
+#endif
+}
+
+// Odd step, so the probes hit off-grid phases
+static uint32_t sine_lut_probe_step(int probes)
+{
+    return (uint32_t)(DDS_TURN / probes) + 7u;
+}
+
+// Error of sinf() itself at the 24-bit phase resolution: the baseline
+// the tables are measured against
+void sine_lut_reference_error(int probes, double *max, double *rms)
+{
+    const uint32_t step = sine_lut_probe_step(probes);
+    double ref_max = 0.0, ref_sq = 0.0;
+    uint32_t ph = 0;
+    for (int i = 0; i < probes; i++, ph += step) {
+        double exact = sin(2.0 * 3.14159265358979323846 * (ph / DDS_TURN));
+        double e = fabs(sinf(2.0f * PI * dds_pos(ph)) - exact);
+        if (e > ref_max) ref_max = e;
+        ref_sq += e * e;
+    }
+    *max = ref_max;
+    *rms = sqrt(ref_sq / probes);
+}
+
+// Error of a 2^bits entry table in both lookup modes against sinf()
+// evaluated at the same phase; returns 0 if the table does not fit
+int sine_lut_measure(wavegen_ctx *ctx, int bits, int probes, sine_lut_error *e)
+{
+    const uint32_t step = sine_lut_probe_step(probes);
+    const int quarter = 1 << (bits - 2);
+    const size_t mark = arena_mark(&ctx->scratch);
+    float *q = (float *)arena_alloc(&ctx->scratch, (size_t)(quarter + 1) * sizeof(float));
+    if (!q) return 0;
+    sine_lut_fill(q, bits);
+
+    double near_max = 0.0, near_sq = 0.0, lin_max = 0.0, lin_sq = 0.0;
+    uint32_t ph = 0;
+    for (int i = 0; i < probes; i++, ph += step) {
+        double ref = sinf(2.0f * PI * dds_pos(ph));
+        double en = fabs(sine_lut_eval(q, bits, 1, ph) - ref);
+        double el = fabs(sine_lut_eval(q, bits, 2, ph) - ref);
+        if (en > near_max) near_max = en;
+        if (el > lin_max) lin_max = el;
+        near_sq += en * en;
+        lin_sq += el * el;
+    }
+    e->near_max = near_max;
+    e->near_rms = sqrt(near_sq / probes);
+    e->lin_max = lin_max;
+    e->lin_rms = sqrt(lin_sq / probes);
+    arena_release(&ctx->scratch, mark);
+    return 1;
+}
+
+// Signed phase offset, e.g. for phase modulation; |cycles| must stay below 2^31
+static inline uint32_t dds_offset(float cycles)
+{
+    return (uint32_t)(int64_t)((double)cycles * DDS_TURN);
+}
+
+/* ---------- Block Kernels (scalar reference + SIMD) ---------- */
+
+/*
+   Every kernel below exists as a plain C reference and, where the CPU has
+   it, as an SSE2 / AVX2 / NEON version. The vector versions perform the same
+   float operations in the same order as the scalar ones (no FMA), so all
+   paths produce bit-identical output as long as the compiler does not fuse
+   the scalar code either (-ffp-contract=off, the default under -std=c11).
+   kernels_init() picks the widest set the CPU supports and
+   WAVEGEN_SIMD=scalar|sse2|avx2|neon forces one; --simd-check verifies.
+*/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WAVEGEN_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define WAVEGEN_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Advance an oscillator by n samples without rendering them
+static inline void dds_advance(dds_osc *o, size_t n)
+{
+    o->phase += (uint32_t)n * o->inc;
+}
+
+// Modulating signal normalized by its base amplitude (0 if the amplitude is 0)
+static inline float norm_mod(float x, float amp_base)
+{
+    return (amp_base != 0.0f) ? (x / amp_base) : 0.0f;
+}
+
+static void k_sine_scalar(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++, ph += inc) out[i] = a * dds_sin(ph);
+}
+
+static void k_square_scalar(uint32_t ph, uint32_t inc, float a, float duty, float *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++, ph += inc) out[i] = (dds_pos(ph) < duty) ? a : -a;
+}
+
+static void k_triangle_scalar(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const float a3 = 3.0f * a, a4 = 4.0f * a;
+    for (size_t i = 0; i < n; i++, ph += inc) {
+        float pos = dds_pos(ph);
+        out[i] = (pos < 0.5f) ? -a + a4 * pos : a3 - a4 * pos;
+    }
+}
+
+static void k_sawtooth_scalar(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const float a2 = 2.0f * a;
+    for (size_t i = 0; i < n; i++, ph += inc) out[i] = -a + a2 * dds_pos(ph);
+}
+
+// In place: xy holds the raw modulating signal on entry, the AM output on exit
+static void k_am_scalar(float *xy, const float *carrier, float amp_base,
+                        float Ac, float m, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        float env = 1.0f + m * norm_mod(xy[i], amp_base);
+        xy[i] = (Ac * env) * carrier[i];
+    }
+}
+
+// In place: compares the modulating signal against a rising ramp carrier
+static void k_pwm_scalar(float *xy, uint32_t ph, uint32_t inc, float amp_base,
+                         float Ac, size_t n)
+{
+    for (size_t i = 0; i < n; i++, ph += inc) {
+        float tri = -1.0f + 2.0f * dds_pos(ph);
+        xy[i] = (norm_mod(xy[i], amp_base) > tri) ? Ac : -Ac;
+    }
+}
+
+// One halfband decimation pass: e and o hold the even and odd input
+// samples, each preceded by the stage history (2 * taps - 1 and taps
+// entries); y[m] is the filter output at input 2m of the block
+static void k_halfband_scalar(const float *e, const float *o, const float *c, size_t taps,
+                              float *y, size_t n)
+{
+    for (size_t m = 0; m < n; m++) {
+        float acc = 0.5f * o[m];
+        for (size_t t = 0; t < taps; t++) acc += c[t] * (e[m + taps - 1 - t] + e[m + taps + t]);
+        y[m] = acc;
+    }
+}
+
+// Radix-2 FFT butterflies on split complex arrays: t = b * w, then
+// b = a - t and a = a + t, for n consecutive pairs
+static void k_butterfly_scalar(float *ar, float *ai, float *br, float *bi,
+                               const float *wr, const float *wi, size_t n)
+{
+    for (size_t j = 0; j < n; j++) {
+        const float tr = br[j] * wr[j] - bi[j] * wi[j];
+        const float ti = br[j] * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] = ar[j] + tr;
+        ai[j] = ai[j] + ti;
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*sine)(uint32_t ph, uint32_t inc, float a, float *out, size_t n);
+    void (*square)(uint32_t ph, uint32_t inc, float a, float duty, float *out, size_t n);
+    void (*triangle)(uint32_t ph, uint32_t inc, float a, float *out, size_t n);
+    void (*sawtooth)(uint32_t ph, uint32_t inc, float a, float *out, size_t n);
+    void (*am)(float *xy, const float *carrier, float amp_base, float Ac, float m, size_t n);
+    void (*pwm)(float *xy, uint32_t ph, uint32_t inc, float amp_base, float Ac, size_t n);
+    void (*halfband)(const float *e, const float *o, const float *c, size_t taps, float *y, size_t n);
+    void (*butterfly)(float *ar, float *ai, float *br, float *bi, const float *wr, const float *wi, size_t n);
+} wave_kernels;
+
+static const wave_kernels kernels_scalar = {
+    "scalar", k_sine_scalar, k_square_scalar, k_triangle_scalar,
+    k_sawtooth_scalar, k_am_scalar, k_pwm_scalar, k_halfband_scalar, k_butterfly_scalar
+};
+
+#if WAVEGEN_X86
+
+/* --- SSE2: 4 samples per iteration --- */
+
+#define SSE2_FN __attribute__((target("sse2")))
+
+SSE2_FN static inline __m128i sse2_phases(uint32_t ph, uint32_t inc)
+{
+    return _mm_setr_epi32((int)ph, (int)(ph + inc), (int)(ph + 2u * inc), (int)(ph + 3u * inc));
+}
+
+SSE2_FN static inline __m128 sse2_pos(__m128i ph)
+{
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(ph, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+}
+
+SSE2_FN static inline __m128 sse2_select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+SSE2_FN static inline __m128 sse2_norm(__m128 x, float amp_base)
+{
+    if (amp_base == 0.0f) return _mm_setzero_ps();
+    return _mm_div_ps(x, _mm_set1_ps(amp_base));
+}
+
+#if SINE_LUT_INTERP != 0
+SSE2_FN static void k_sine_sse2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const int shift = 32 - SINE_LUT_BITS;
+    const __m128i step = _mm_set1_epi32((int)(4u * inc));
+    const __m128 va = _mm_set1_ps(a);
+    __m128i vph = sse2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i p = vph;
+        if (SINE_LUT_INTERP == 1) p = _mm_add_epi32(p, _mm_set1_epi32(1 << (shift - 1)));
+        __m128i idx = _mm_srli_epi32(p, shift);
+        __m128i quad = _mm_srli_epi32(idx, SINE_LUT_BITS - 2);
+        uint32_t kk[4], qq[4];
+        float av[4], bv[4];
+        _mm_storeu_si128((__m128i *)kk, _mm_and_si128(idx, _mm_set1_epi32(SINE_LUT_QUARTER - 1)));
+        _mm_storeu_si128((__m128i *)qq, quad);
+        // No gather in SSE2: fetch the table entries one lane at a time
+        for (int j = 0; j < 4; j++) {
+            if (qq[j] & 1) { av[j] = sine_qtab[SINE_LUT_QUARTER - kk[j]]; bv[j] = sine_qtab[SINE_LUT_QUARTER - kk[j] - 1]; }
+            else           { av[j] = sine_qtab[kk[j]];                  bv[j] = sine_qtab[kk[j] + 1]; }
+        }
+        __m128 y = _mm_loadu_ps(av);
+        if (SINE_LUT_INTERP == 2) {
+            __m128 frac = _mm_mul_ps(
+                _mm_cvtepi32_ps(_mm_and_si128(p, _mm_set1_epi32((int)((1u << shift) - 1)))),
+                _mm_set1_ps(1.0f / (float)(1u << shift)));
+            y = _mm_add_ps(y, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(bv), y), frac));
+        }
+        // Quadrants 2 and 3 are negative: move bit 1 of quad into the sign bit
+        __m128i sign = _mm_slli_epi32(_mm_and_si128(quad, _mm_set1_epi32(2)), 30);
+        y = _mm_xor_ps(y, _mm_castsi128_ps(sign));
+        _mm_storeu_ps(out + i, _mm_mul_ps(va, y));
+        vph = _mm_add_epi32(vph, step);
+    }
+    k_sine_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+#else
+#define k_sine_sse2 k_sine_scalar
+#endif
+
+SSE2_FN static void k_square_sse2(uint32_t ph, uint32_t inc, float a, float duty, float *out, size_t n)
+{
+    const __m128i step = _mm_set1_epi32((int)(4u * inc));
+    const __m128 va = _mm_set1_ps(a), vna = _mm_set1_ps(-a), vduty = _mm_set1_ps(duty);
+    __m128i vph = sse2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 hi = _mm_cmplt_ps(sse2_pos(vph), vduty);
+        _mm_storeu_ps(out + i, sse2_select(hi, va, vna));
+        vph = _mm_add_epi32(vph, step);
+    }
+    k_square_scalar(ph + (uint32_t)i * inc, inc, a, duty, out + i, n - i);
+}
+
+SSE2_FN static void k_triangle_sse2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const __m128i step = _mm_set1_epi32((int)(4u * inc));
+    const __m128 vna = _mm_set1_ps(-a), va3 = _mm_set1_ps(3.0f * a), va4 = _mm_set1_ps(4.0f * a);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128i vph = sse2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 pos = sse2_pos(vph);
+        __m128 up = _mm_add_ps(vna, _mm_mul_ps(va4, pos));
+        __m128 down = _mm_sub_ps(va3, _mm_mul_ps(va4, pos));
+        _mm_storeu_ps(out + i, sse2_select(_mm_cmplt_ps(pos, half), up, down));
+        vph = _mm_add_epi32(vph, step);
+    }
+    k_triangle_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+SSE2_FN static void k_sawtooth_sse2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const __m128i step = _mm_set1_epi32((int)(4u * inc));
+    const __m128 vna = _mm_set1_ps(-a), va2 = _mm_set1_ps(2.0f * a);
+    __m128i vph = sse2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(vna, _mm_mul_ps(va2, sse2_pos(vph))));
+        vph = _mm_add_epi32(vph, step);
+    }
+    k_sawtooth_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+SSE2_FN static void k_am_sse2(float *xy, const float *carrier, float amp_base,
+                             float Ac, float m, size_t n)
+{
+    const __m128 one = _mm_set1_ps(1.0f), vm = _mm_set1_ps(m), vAc = _mm_set1_ps(Ac);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 env = _mm_add_ps(one, _mm_mul_ps(vm, sse2_norm(_mm_loadu_ps(xy + i), amp_base)));
+        _mm_storeu_ps(xy + i, _mm_mul_ps(_mm_mul_ps(vAc, env), _mm_loadu_ps(carrier + i)));
+    }
+    k_am_scalar(xy + i, carrier + i, amp_base, Ac, m, n - i);
+}
+
+SSE2_FN static void k_pwm_sse2(float *xy, uint32_t ph, uint32_t inc, float amp_base,
+                              float Ac, size_t n)
+{
+    const __m128i step = _mm_set1_epi32((int)(4u * inc));
+    const __m128 vAc = _mm_set1_ps(Ac), vnAc = _mm_set1_ps(-Ac);
+    const __m128 minus_one = _mm_set1_ps(-1.0f), two = _mm_set1_ps(2.0f);
+    __m128i vph = sse2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 tri = _mm_add_ps(minus_one, _mm_mul_ps(two, sse2_pos(vph)));
+        __m128 hi = _mm_cmpgt_ps(sse2_norm(_mm_loadu_ps(xy + i), amp_base), tri);
+        _mm_storeu_ps(xy + i, sse2_select(hi, vAc, vnAc));
+        vph = _mm_add_epi32(vph, step);
+    }
+    k_pwm_scalar(xy + i, ph + (uint32_t)i * inc, inc, amp_base, Ac, n - i);
+}
+
+// Four outputs at a time; each lane sums its taps in the scalar order
+SSE2_FN static void k_halfband_sse2(const float *e, const float *o, const float *c, size_t taps,
+                                    float *y, size_t n)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t m = 0;
+    for (; m + 4 <= n; m += 4) {
+        __m128 acc = _mm_mul_ps(half, _mm_loadu_ps(o + m));
+        for (size_t t = 0; t < taps; t++) {
+            __m128 pair = _mm_add_ps(_mm_loadu_ps(e + m + taps - 1 - t), _mm_loadu_ps(e + m + taps + t));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(c[t]), pair));
+        }
+        _mm_storeu_ps(y + m, acc);
+    }
+    k_halfband_scalar(e + m, o + m, c, taps, y + m, n - m);
+}
+
+SSE2_FN static void k_butterfly_sse2(float *ar, float *ai, float *br, float *bi,
+                                     const float *wr, const float *wi, size_t n)
+{
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const __m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+        const __m128 cr = _mm_loadu_ps(wr + j), ci = _mm_loadu_ps(wi + j);
+        const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+        const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+        const __m128 yr = _mm_loadu_ps(ar + j), yi = _mm_loadu_ps(ai + j);
+        _mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+        _mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+        _mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+        _mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+    }
+    k_butterfly_scalar(ar + j, ai + j, br + j, bi + j, wr + j, wi + j, n - j);
+}
+
+static const wave_kernels kernels_sse2 = {
+    "sse2", k_sine_sse2, k_square_sse2, k_triangle_sse2,
+    k_sawtooth_sse2, k_am_sse2, k_pwm_sse2, k_halfband_sse2, k_butterfly_sse2
+};
+
+/* --- AVX2: 8 samples per iteration --- */
+
+#define AVX2_FN __attribute__((target("avx2")))
+
+AVX2_FN static inline __m256i avx2_phases(uint32_t ph, uint32_t inc)
+{
+    return _mm256_add_epi32(_mm256_set1_epi32((int)ph),
+                            _mm256_mullo_epi32(_mm256_set1_epi32((int)inc),
+                                               _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+}
+
+AVX2_FN static inline __m256 avx2_pos(__m256i ph)
+{
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(ph, 8)),
+                         _mm256_set1_ps(1.0f / 16777216.0f));
+}
+
+AVX2_FN static inline __m256 avx2_norm(__m256 x, float amp_base)
+{
+    if (amp_base == 0.0f) return _mm256_setzero_ps();
+    return _mm256_div_ps(x, _mm256_set1_ps(amp_base));
+}
+
+#if SINE_LUT_INTERP != 0
+AVX2_FN static void k_sine_avx2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const int shift = 32 - SINE_LUT_BITS;
+    const __m256i step = _mm256_set1_epi32((int)(8u * inc));
+    const __m256i qmask = _mm256_set1_epi32(SINE_LUT_QUARTER - 1);
+    const __m256i vquarter = _mm256_set1_epi32(SINE_LUT_QUARTER);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256 va = _mm256_set1_ps(a);
+    __m256i vph = avx2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i p = vph;
+        if (SINE_LUT_INTERP == 1) p = _mm256_add_epi32(p, _mm256_set1_epi32(1 << (shift - 1)));
+        __m256i idx = _mm256_srli_epi32(p, shift);
+        __m256i k = _mm256_and_si256(idx, qmask);
+        __m256i quad = _mm256_srli_epi32(idx, SINE_LUT_BITS - 2);
+        // Odd quadrants read the quarter table backwards
+        __m256i odd = _mm256_cmpeq_epi32(_mm256_and_si256(quad, one), one);
+        __m256i mirror = _mm256_sub_epi32(vquarter, k);
+        __m256i ia = _mm256_blendv_epi8(k, mirror, odd);
+        __m256 y = _mm256_i32gather_ps(sine_qtab, ia, 4);
+        if (SINE_LUT_INTERP == 2) {
+            __m256i ib = _mm256_blendv_epi8(_mm256_add_epi32(k, one), _mm256_sub_epi32(mirror, one), odd);
+            __m256 b = _mm256_i32gather_ps(sine_qtab, ib, 4);
+            __m256 frac = _mm256_mul_ps(
+                _mm256_cvtepi32_ps(_mm256_and_si256(p, _mm256_set1_epi32((int)((1u << shift) - 1)))),
+                _mm256_set1_ps(1.0f / (float)(1u << shift)));
+            y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_sub_ps(b, y), frac));
+        }
+        __m256i sign = _mm256_slli_epi32(_mm256_and_si256(quad, _mm256_set1_epi32(2)), 30);
+        y = _mm256_xor_ps(y, _mm256_castsi256_ps(sign));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(va, y));
+        vph = _mm256_add_epi32(vph, step);
+    }
+    k_sine_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+#else
+#define k_sine_avx2 k_sine_scalar
+#endif
+
+AVX2_FN static void k_square_avx2(uint32_t ph, uint32_t inc, float a, float duty, float *out, size_t n)
+{
+    const __m256i step = _mm256_set1_epi32((int)(8u * inc));
+    const __m256 va = _mm256_set1_ps(a), vna = _mm256_set1_ps(-a), vduty = _mm256_set1_ps(duty);
+    __m256i vph = avx2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 hi = _mm256_cmp_ps(avx2_pos(vph), vduty, _CMP_LT_OQ);
+        _mm256_storeu_ps(out + i, _mm256_blendv_ps(vna, va, hi));
+        vph = _mm256_add_epi32(vph, step);
+    }
+    k_square_scalar(ph + (uint32_t)i * inc, inc, a, duty, out + i, n - i);
+}
+
+AVX2_FN static void k_triangle_avx2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const __m256i step = _mm256_set1_epi32((int)(8u * inc));
+    const __m256 vna = _mm256_set1_ps(-a), va3 = _mm256_set1_ps(3.0f * a), va4 = _mm256_set1_ps(4.0f * a);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256i vph = avx2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 pos = avx2_pos(vph);
+        __m256 up = _mm256_add_ps(vna, _mm256_mul_ps(va4, pos));
+        __m256 down = _mm256_sub_ps(va3, _mm256_mul_ps(va4, pos));
+        _mm256_storeu_ps(out + i, _mm256_blendv_ps(down, up, _mm256_cmp_ps(pos, half, _CMP_LT_OQ)));
+        vph = _mm256_add_epi32(vph, step);
+    }
+    k_triangle_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+AVX2_FN static void k_sawtooth_avx2(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const __m256i step = _mm256_set1_epi32((int)(8u * inc));
+    const __m256 vna = _mm256_set1_ps(-a), va2 = _mm256_set1_ps(2.0f * a);
+    __m256i vph = avx2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(vna, _mm256_mul_ps(va2, avx2_pos(vph))));
+        vph = _mm256_add_epi32(vph, step);
+    }
+    k_sawtooth_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+AVX2_FN static void k_am_avx2(float *xy, const float *carrier, float amp_base,
+                             float Ac, float m, size_t n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f), vm = _mm256_set1_ps(m), vAc = _mm256_set1_ps(Ac);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 env = _mm256_add_ps(one, _mm256_mul_ps(vm, avx2_norm(_mm256_loadu_ps(xy + i), amp_base)));
+        _mm256_storeu_ps(xy + i, _mm256_mul_ps(_mm256_mul_ps(vAc, env), _mm256_loadu_ps(carrier + i)));
+    }
+    k_am_scalar(xy + i, carrier + i, amp_base, Ac, m, n - i);
+}
+
+AVX2_FN static void k_pwm_avx2(float *xy, uint32_t ph, uint32_t inc, float amp_base,
+                              float Ac, size_t n)
+{
+    const __m256i step = _mm256_set1_epi32((int)(8u * inc));
+    const __m256 vAc = _mm256_set1_ps(Ac), vnAc = _mm256_set1_ps(-Ac);
+    const __m256 minus_one = _mm256_set1_ps(-1.0f), two = _mm256_set1_ps(2.0f);
+    __m256i vph = avx2_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 tri = _mm256_add_ps(minus_one, _mm256_mul_ps(two, avx2_pos(vph)));
+        __m256 hi = _mm256_cmp_ps(avx2_norm(_mm256_loadu_ps(xy + i), amp_base), tri, _CMP_GT_OQ);
+        _mm256_storeu_ps(xy + i, _mm256_blendv_ps(vnAc, vAc, hi));
+        vph = _mm256_add_epi32(vph, step);
+    }
+    k_pwm_scalar(xy + i, ph + (uint32_t)i * inc, inc, amp_base, Ac, n - i);
+}
+
+AVX2_FN static void k_halfband_avx2(const float *e, const float *o, const float *c, size_t taps,
+                                    float *y, size_t n)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t m = 0;
+    for (; m + 8 <= n; m += 8) {
+        __m256 acc = _mm256_mul_ps(half, _mm256_loadu_ps(o + m));
+        for (size_t t = 0; t < taps; t++) {
+            __m256 pair = _mm256_add_ps(_mm256_loadu_ps(e + m + taps - 1 - t),
+                                        _mm256_loadu_ps(e + m + taps + t));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(c[t]), pair));
+        }
+        _mm256_storeu_ps(y + m, acc);
+    }
+    k_halfband_scalar(e + m, o + m, c, taps, y + m, n - m);
+}
+
+AVX2_FN static void k_butterfly_avx2(float *ar, float *ai, float *br, float *bi,
+                                     const float *wr, const float *wi, size_t n)
+{
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m256 xr = _mm256_loadu_ps(br + j), xi = _mm256_loadu_ps(bi + j);
+        const __m256 cr = _mm256_loadu_ps(wr + j), ci = _mm256_loadu_ps(wi + j);
+        const __m256 tr = _mm256_sub_ps(_mm256_mul_ps(xr, cr), _mm256_mul_ps(xi, ci));
+        const __m256 ti = _mm256_add_ps(_mm256_mul_ps(xr, ci), _mm256_mul_ps(xi, cr));
+        const __m256 yr = _mm256_loadu_ps(ar + j), yi = _mm256_loadu_ps(ai + j);
+        _mm256_storeu_ps(br + j, _mm256_sub_ps(yr, tr));
+        _mm256_storeu_ps(bi + j, _mm256_sub_ps(yi, ti));
+        _mm256_storeu_ps(ar + j, _mm256_add_ps(yr, tr));
+        _mm256_storeu_ps(ai + j, _mm256_add_ps(yi, ti));
+    }
+    k_butterfly_scalar(ar + j, ai + j, br + j, bi + j, wr + j, wi + j, n - j);
+}
+
+static const wave_kernels kernels_avx2 = {
+    "avx2", k_sine_avx2, k_square_avx2, k_triangle_avx2,
+    k_sawtooth_avx2, k_am_avx2, k_pwm_avx2, k_halfband_avx2, k_butterfly_avx2
+};
+
+#endif /* WAVEGEN_X86 */
+
+#if WAVEGEN_NEON
+
+/* --- NEON: 4 samples per iteration --- */
+
+static inline uint32x4_t neon_phases(uint32_t ph, uint32_t inc)
+{
+    const uint32_t lanes[4] = { ph, ph + inc, ph + 2u * inc, ph + 3u * inc };
+    return vld1q_u32(lanes);
+}
+
+static inline float32x4_t neon_pos(uint32x4_t ph)
+{
+    return vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(ph, 8)), vdupq_n_f32(1.0f / 16777216.0f));
+}
+
+static inline float32x4_t neon_norm(float32x4_t x, float amp_base)
+{
+    if (amp_base == 0.0f) return vdupq_n_f32(0.0f);
+#if defined(__aarch64__)
+    return vdivq_f32(x, vdupq_n_f32(amp_base));
+#else
+    // ARMv7 NEON has no vector divide; keep the exact scalar division per lane
+    float v[4];
+    vst1q_f32(v, x);
+    for (int j = 0; j < 4; j++) v[j] /= amp_base;
+    return vld1q_f32(v);
+#endif
+}
+
+#if SINE_LUT_INTERP != 0
+static void k_sine_neon(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const int shift = 32 - SINE_LUT_BITS;
+    const uint32x4_t step = vdupq_n_u32(4u * inc);
+    uint32x4_t vph = neon_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t p = vph;
+        if (SINE_LUT_INTERP == 1) p = vaddq_u32(p, vdupq_n_u32(1u << (shift - 1)));
+        uint32_t pp[4];
+        float av[4], bv[4];
+        vst1q_u32(pp, p);
+        for (int j = 0; j < 4; j++) {
+            uint32_t idx = pp[j] >> shift;
+            uint32_t k = idx & (SINE_LUT_QUARTER - 1);
+            if ((idx >> (SINE_LUT_BITS - 2)) & 1) { av[j] = sine_qtab[SINE_LUT_QUARTER - k]; bv[j] = sine_qtab[SINE_LUT_QUARTER - k - 1]; }
+            else                                  { av[j] = sine_qtab[k];                  bv[j] = sine_qtab[k + 1]; }
+        }
+        float32x4_t y = vld1q_f32(av);
+        if (SINE_LUT_INTERP == 2) {
+            float32x4_t frac = vmulq_f32(vcvtq_f32_u32(vandq_u32(p, vdupq_n_u32((1u << shift) - 1))),
+                                         vdupq_n_f32(1.0f / (float)(1u << shift)));
+            y = vaddq_f32(y, vmulq_f32(vsubq_f32(vld1q_f32(bv), y), frac));
+        }
+        // Quadrants 2 and 3: the quad's bit 1 sits at phase bit 31
+        uint32x4_t sign = vandq_u32(p, vdupq_n_u32(0x80000000u));
+        y = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(y), sign));
+        vst1q_f32(out + i, vmulq_f32(vdupq_n_f32(a), y));
+        vph = vaddq_u32(vph, step);
+    }
+    k_sine_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+#else
+#define k_sine_neon k_sine_scalar
+#endif
+
+static void k_square_neon(uint32_t ph, uint32_t inc, float a, float duty, float *out, size_t n)
+{
+    const uint32x4_t step = vdupq_n_u32(4u * inc);
+    const float32x4_t va = vdupq_n_f32(a), vna = vdupq_n_f32(-a), vduty = vdupq_n_f32(duty);
+    uint32x4_t vph = neon_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vbslq_f32(vcltq_f32(neon_pos(vph), vduty), va, vna));
+        vph = vaddq_u32(vph, step);
+    }
+    k_square_scalar(ph + (uint32_t)i * inc, inc, a, duty, out + i, n - i);
+}
+
+static void k_triangle_neon(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const uint32x4_t step = vdupq_n_u32(4u * inc);
+    const float32x4_t vna = vdupq_n_f32(-a), va3 = vdupq_n_f32(3.0f * a), va4 = vdupq_n_f32(4.0f * a);
+    uint32x4_t vph = neon_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t pos = neon_pos(vph);
+        float32x4_t up = vaddq_f32(vna, vmulq_f32(va4, pos));
+        float32x4_t down = vsubq_f32(va3, vmulq_f32(va4, pos));
+        vst1q_f32(out + i, vbslq_f32(vcltq_f32(pos, vdupq_n_f32(0.5f)), up, down));
+        vph = vaddq_u32(vph, step);
+    }
+    k_triangle_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+static void k_sawtooth_neon(uint32_t ph, uint32_t inc, float a, float *out, size_t n)
+{
+    const uint32x4_t step = vdupq_n_u32(4u * inc);
+    const float32x4_t vna = vdupq_n_f32(-a), va2 = vdupq_n_f32(2.0f * a);
+    uint32x4_t vph = neon_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vaddq_f32(vna, vmulq_f32(va2, neon_pos(vph))));
+        vph = vaddq_u32(vph, step);
+    }
+    k_sawtooth_scalar(ph + (uint32_t)i * inc, inc, a, out + i, n - i);
+}
+
+static void k_am_neon(float *xy, const float *carrier, float amp_base,
+                      float Ac, float m, size_t n)
+{
+    const float32x4_t one = vdupq_n_f32(1.0f), vm = vdupq_n_f32(m), vAc = vdupq_n_f32(Ac);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t env = vaddq_f32(one, vmulq_f32(vm, neon_norm(vld1q_f32(xy + i), amp_base)));
+        vst1q_f32(xy + i, vmulq_f32(vmulq_f32(vAc, env), vld1q_f32(carrier + i)));
+    }
+    k_am_scalar(xy + i, carrier + i, amp_base, Ac, m, n - i);
+}
+
+static void k_pwm_neon(float *xy, uint32_t ph, uint32_t inc, float amp_base,
+                       float Ac, size_t n)
+{
+    const uint32x4_t step = vdupq_n_u32(4u * inc);
+    const float32x4_t vAc = vdupq_n_f32(Ac), vnAc = vdupq_n_f32(-Ac);
+    const float32x4_t minus_one = vdupq_n_f32(-1.0f), two = vdupq_n_f32(2.0f);
+    uint32x4_t vph = neon_phases(ph, inc);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t tri = vaddq_f32(minus_one, vmulq_f32(two, neon_pos(vph)));
+        uint32x4_t hi = vcgtq_f32(neon_norm(vld1q_f32(xy + i), amp_base), tri);
+        vst1q_f32(xy + i, vbslq_f32(hi, vAc, vnAc));
+        vph = vaddq_u32(vph, step);
+    }
+    k_pwm_scalar(xy + i, ph + (uint32_t)i * inc, inc, amp_base, Ac, n - i);
+}
+
+static void k_halfband_neon(const float *e, const float *o, const float *c, size_t taps,
+                            float *y, size_t n)
+{
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    size_t m = 0;
+    for (; m + 4 <= n; m += 4) {
+        float32x4_t acc = vmulq_f32(half, vld1q_f32(o + m));
+        for (size_t t = 0; t < taps; t++) {
+            float32x4_t pair = vaddq_f32(vld1q_f32(e + m + taps - 1 - t), vld1q_f32(e + m + taps + t));
+            acc = vaddq_f32(acc, vmulq_f32(vdupq_n_f32(c[t]), pair));
+        }
+        vst1q_f32(y + m, acc);
+    }
+    k_halfband_scalar(e + m, o + m, c, taps, y + m, n - m);
+}
+
+static void k_butterfly_neon(float *ar, float *ai, float *br, float *bi,
+                             const float *wr, const float *wi, size_t n)
+{
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const float32x4_t xr = vld1q_f32(br + j), xi = vld1q_f32(bi + j);
+        const float32x4_t cr = vld1q_f32(wr + j), ci = vld1q_f32(wi + j);
+        const float32x4_t tr = vsubq_f32(vmulq_f32(xr, cr), vmulq_f32(xi, ci));
+        const float32x4_t ti = vaddq_f32(vmulq_f32(xr, ci), vmulq_f32(xi, cr));
+        const float32x4_t yr = vld1q_f32(ar + j), yi = vld1q_f32(ai + j);
+        vst1q_f32(br + j, vsubq_f32(yr, tr));
+        vst1q_f32(bi + j, vsubq_f32(yi, ti));
+        vst1q_f32(ar + j, vaddq_f32(yr, tr));
+        vst1q_f32(ai + j, vaddq_f32(yi, ti));
+    }
+    k_butterfly_scalar(ar + j, ai + j, br + j, bi + j, wr + j, wi + j, n - j);
+}
+
+static const wave_kernels kernels_neon = {
+    "neon", k_sine_neon, k_square_neon, k_triangle_neon,
+    k_sawtooth_neon, k_am_neon, k_pwm_neon, k_halfband_neon, k_butterfly_neon
+};
+
+#endif /* WAVEGEN_NEON */
+
+// Active kernel set, chosen once at startup
+static const wave_kernels *kern = &kernels_scalar;
+
+// Lists the kernel sets this CPU can run, widest last
+static int available_kernels(const wave_kernels **sets, int max)
+{
+    int count = 0;
+    if (count < max) sets[count++] = &kernels_scalar;
+#if WAVEGEN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2") && count < max) sets[count++] = &kernels_sse2;
+    if (__builtin_cpu_supports("avx2") && count < max) sets[count++] = &kernels_avx2;
+#elif WAVEGEN_NEON
+    if (count < max) sets[count++] = &kernels_neon;
+#endif
+    return count;
+}
+
+void kernels_init(void)
+{
+    const wave_kernels *sets[4];
+    int count = available_kernels(sets, 4);
+    const char *force = getenv("WAVEGEN_SIMD");
+
+    kern = sets[count - 1];
+    if (force) {
+        for (int i = 0; i < count; i++) {
+            if (strcmp(sets[i]->name, force) == 0) kern = sets[i];
+        }
+    }
+}
+
+const char *kernels_name(void)
+{
+    return kern->name;
+}
+
+// Runs every kernel set against the scalar reference and hands each
+// verdict to report (may be NULL); returns 1 if all match bit for bit
+int kernels_self_check(wavegen_ctx *ctx, void (*report)(const char *name, int ok))
+{
+    const wave_kernels *sets[4];
+    int count = available_kernels(sets, 4);
+    const size_t max_n = 1031; // Odd length exercises the scalar tails
+    const size_t mark = arena_mark(&ctx->scratch);
+    float *ref = (float *)arena_alloc(&ctx->scratch, max_n * sizeof(float));
+    float *got = (float *)arena_alloc(&ctx->scratch, max_n * sizeof(float));
+    float *car = (float *)arena_alloc(&ctx->scratch, max_n * sizeof(float));
+    float *odd = (float *)arena_alloc(&ctx->scratch, max_n * sizeof(float));
+    float *even = (float *)arena_alloc(&ctx->scratch, (max_n + 2 * HALFBAND_MAX_TAPS) * sizeof(float));
+    float *bfly = (float *)arena_alloc(&ctx->scratch, 8 * max_n * sizeof(float));  // ar ai br bi, twice
+    float coef[HALFBAND_MAX_TAPS];
+    int all_ok = 1;
+
+    if (!ref || !got || !car || !odd || !even || !bfly) { arena_release(&ctx->scratch, mark); return 0; }
+    for (size_t t = 0; t < HALFBAND_MAX_TAPS; t++) coef[t] = 0.3f / (float)(2 * t + 1) * ((t & 1) ? -1.0f : 1.0f);
+
+    for (int s = 0; s < count; s++) {
+        int ok = 1;
+        for (size_t n = 1; n <= max_n && ok; n += 37) {
+            uint32_t ph = 0x9E3779B9u * (uint32_t)n, inc = 0x01234567u + 977u * (uint32_t)n;
+            float a = 0.25f + (float)n / 512.0f, duty = (float)(n % 10) / 10.0f;
+
+            kernels_scalar.sine(ph, inc, a, ref, n);     sets[s]->sine(ph, inc, a, got, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+            kernels_scalar.square(ph, inc, a, duty, ref, n); sets[s]->square(ph, inc, a, duty, got, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+            kernels_scalar.triangle(ph, inc, a, ref, n); sets[s]->triangle(ph, inc, a, got, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+            kernels_scalar.sawtooth(ph, inc, a, ref, n); sets[s]->sawtooth(ph, inc, a, got, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+
+            // Modulators: same modulating signal in, same output out
+            kernels_scalar.sine(ph, inc * 3u, 1.0f, car, n);
+            kernels_scalar.triangle(ph, inc, a, ref, n); memcpy(got, ref, n * sizeof(float));
+            kernels_scalar.am(ref, car, a, 1.5f, 0.7f, n); sets[s]->am(got, car, a, 1.5f, 0.7f, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+            kernels_scalar.triangle(ph, inc, a, ref, n); memcpy(got, ref, n * sizeof(float));
+            kernels_scalar.pwm(ref, ph, inc * 5u, a, 2.0f, n); sets[s]->pwm(got, ph, inc * 5u, a, 2.0f, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+
+            // Decimator: any signal through the shortest and the longest stage
+            const size_t taps = 1 + n % HALFBAND_MAX_TAPS;
+            kernels_scalar.sawtooth(ph, inc, a, even, n + 2 * taps - 1);
+            kernels_scalar.sine(ph, inc * 7u, a, odd, n);
+            kernels_scalar.halfband(even, odd, coef, taps, ref, n);
+            sets[s]->halfband(even, odd, coef, taps, got, n);
+            ok &= memcmp(ref, got, n * sizeof(float)) == 0;
+
+            // FFT butterflies: four arbitrary inputs, the twiddles from two more
+            float *b = bfly, *g = bfly + 4 * max_n;
+            kernels_scalar.sine(ph, inc, a, b, n);
+            kernels_scalar.triangle(ph, inc * 3u, a, b + max_n, n);
+            kernels_scalar.sawtooth(ph, inc * 5u, a, b + 2 * max_n, n);
+            kernels_scalar.sine(ph + 0x40000000u, inc * 7u, a, b + 3 * max_n, n);
+            kernels_scalar.sine(ph, inc * 11u, 1.0f, car, n);
+            kernels_scalar.sine(ph + 0x40000000u, inc * 11u, 1.0f, ref, n);
+            memcpy(g, b, 4 * max_n * sizeof(float));
+            kernels_scalar.butterfly(b, b + max_n, b + 2 * max_n, b + 3 * max_n, car, ref, n);
+            sets[s]->butterfly(g, g + max_n, g + 2 * max_n, g + 3 * max_n, car, ref, n);
+            ok &= memcmp(b, g, 4 * max_n * sizeof(float)) == 0;
+        }
+        if (report) report(sets[s]->name, ok);
+        all_ok &= ok;
+    }
+
+    arena_release(&ctx->scratch, mark);
+    return all_ok;
+}
+
+#if WAVEGEN_STATS
+/* ---------- Instrumentation ---------- */
+
+/*
+   Every slot holds calls, samples, wall time and cycles. Slots nest (the
+   modulators run inside "render"), so times are inclusive. Updates are
+   relaxed atomics: pool workers and the stream producer all book here.
+   Cycles come from the TSC on x86 and from DWT CYCCNT on Cortex-M, where
+   CLOCK_MONOTONIC is usually missing and time is derived from the core
+   clock instead (WAVEGEN_CPU_HZ).
+*/
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define STAT_DWT 1
+#define DWT_CTRL   (*(volatile uint32_t *)0xE0001000u)
+#define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004u)
+#define CM_DEMCR   (*(volatile uint32_t *)0xE000EDFCu)
+#ifndef WAVEGEN_CPU_HZ
+#define WAVEGEN_CPU_HZ 64000000u
+#endif
+#endif
+
+typedef struct {
+    _Atomic uint64_t calls, samples, ns, cycles;
+} stat_slot;
+
+static stat_slot stat_slots[STAT_SLOTS];
+static const char *const stat_names[STAT_SLOTS] = {
+    "render", "mod am", "mod fm", "mod pwm", "mod pm", "ascii", "sink", "underrun", "overrun"
+};
+
+// Starts the cycle counter; a host arms its dump signal separately
+// (stats_watch_signal in wavegen_io.h)
+void stats_init(void)
+{
+#if STAT_DWT
+    CM_DEMCR |= 1u << 24;  // TRCENA
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1u;        // CYCCNTENA
+#endif
+}
+
+stat_mark stat_begin(void)
+{
+    stat_mark m;
+#if STAT_DWT
+    m.cycles = DWT_CYCCNT;
+    m.ns = 0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    m.ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#if WAVEGEN_X86
+    m.cycles = __rdtsc();
+#else
+    m.cycles = 0;
+#endif
+#endif
+    return m;
+}
+
+void stat_end(int slot, const stat_mark *m, size_t samples)
+{
+    stat_mark now = stat_begin();
+    stat_slot *s = &stat_slots[slot];
+#if STAT_DWT
+    uint64_t cycles = (uint32_t)(now.cycles - m->cycles);  // CYCCNT is 32 bits and wraps
+    uint64_t ns = cycles * 1000000000u / WAVEGEN_CPU_HZ;
+#else
+    uint64_t cycles = now.cycles - m->cycles;
+    uint64_t ns = now.ns - m->ns;
+#endif
+    atomic_fetch_add_explicit(&s->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->samples, samples, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s->cycles, cycles, memory_order_relaxed);
+}
+
+void stat_count(int slot)
+{
+    atomic_fetch_add_explicit(&stat_slots[slot].calls, 1, memory_order_relaxed);
+}
+
+// Totals of one slot so far
+void stats_read(int slot, stat_totals *t)
+{
+    const stat_slot *s = &stat_slots[slot];
+    t->calls = atomic_load_explicit(&s->calls, memory_order_relaxed);
+    t->samples = atomic_load_explicit(&s->samples, memory_order_relaxed);
+    t->ns = atomic_load_explicit(&s->ns, memory_order_relaxed);
+    t->cycles = atomic_load_explicit(&s->cycles, memory_order_relaxed);
+}
+
+const char *stat_name(int slot)
+{
+    return stat_names[slot];
+}
+#endif /* WAVEGEN_STATS */
+
+/* ---------- Band-Limited Edges ---------- */
+
+/*
+   The naive square and sawtooth jump within one sample and the triangle
+   turns a sharp corner; above a few hundred Hz the harmonics this implies
+   fold back below Nyquist. PolyBLEP replaces each jump with a two-sample
+   polynomial band-limited step, PolyBLAMP does the same for each corner
+   with the integrated step. The kernels still render the naive shape; a
+   scalar pass then corrects the two samples around each discontinuity, so
+   clean output costs one extra pass at 1x instead of oversampling.
+*/
+
+// Band-limited step residual at cycle position t, for a step of +-1
+static inline float poly_blep(float t, float dt)
+{
+    if (t < dt) { float x = t / dt; return x + x - x * x - 1.0f; }
+    if (t > 1.0f - dt) { float x = (t - 1.0f) / dt; return x * x + x + x + 1.0f; }
+    return 0.0f;
+}
+
+// Band-limited ramp residual at cycle position t, for a slope change of 2 per sample
+static inline float poly_blamp(float t, float dt)
+{
+    if (t < dt) { float x = t / dt - 1.0f; return -(x * x * x) * (1.0f / 3.0f); }
+    if (t > 1.0f - dt) { float x = (t - 1.0f) / dt + 1.0f; return (x * x * x) * (1.0f / 3.0f); }
+    return 0.0f;
+}
+
+// Adds h times the step (or ramp) residual to the two samples around every
+// crossing of phase `edge`, so the cost is per cycle rather than per sample
+static void blep_at(uint32_t ph, uint32_t inc, uint32_t edge, float h, float dt,
+                    int ramp, float *out, size_t n)
+{
+    // Measured from sample -1, so a crossing just before out[0] is still seen
+    const uint64_t d = (uint32_t)(edge - (ph - inc));
+    for (uint64_t k = 0; ; k++) {
+        // First sample at or past the k-th crossing, counting from sample -1
+        uint64_t i = (d + (k << 32) + inc - 1) / inc;
+        if (i > n + 1) break;
+        for (uint64_t j = i ? i - 1 : 0; j <= i; j++) {
+            if (j == 0 || j > n) continue;
+            float t = dds_pos(ph + (uint32_t)(j - 1) * inc - edge);
+            out[j - 1] += h * (ramp ? poly_blamp(t, dt) : poly_blep(t, dt));
+        }
+    }
+}
+
+// Corrects a naive block rendered from phase ph in place
+static void blep_correct(int waveform_type, const wave_params *p, uint32_t ph, uint32_t inc,
+                         float *out, size_t n)
+{
+    const float dt = (float)inc * (float)(1.0 / DDS_TURN);
+    const float a = p->amp;
+    if (dt <= 0.0f || dt >= 0.5f) return; // Static, or too fast for a 2-sample kernel
+
+    switch (waveform_type) {
+        case 2:
+            // Rising edge at 0, falling edge at duty (they cancel at duty 0 or 1)
+            blep_at(ph, inc, 0, a, dt, 0, out, n);
+            blep_at(ph, inc, dds_phase_from_cycles(p->duty), -a, dt, 0, out, n);
+            break;
+        case 3:
+            // Slope turns by +-8a per cycle at the trough (0) and the peak (1/2);
+            // the residuals, like poly_blep, are scaled for a change of 2
+            blep_at(ph, inc, 0, 4.0f * a * dt, dt, 1, out, n);
+            blep_at(ph, inc, 0x80000000u, -4.0f * a * dt, dt, 1, out, n);
+            break;
+        case 4:
+            // Drops by 2a at the wrap
+            blep_at(ph, inc, 0, -a, dt, 0, out, n);
+            break;
+        default:
+            break;
+    }
+}
+
+// Renders n samples from the oscillator's current phase and advances it.
+// Costs one integer add per sample regardless of how long the stream runs.
+void render_dds_block(int waveform_type, const wave_params *p, dds_osc *o,
+                      float *out, size_t n)
+{
+    switch (waveform_type) {
+        case 1: kern->sine(o->phase, o->inc, p->amp, out, n); break;
+        case 2: kern->square(o->phase, o->inc, p->amp, p->duty, out, n); break;
+        case 3: kern->triangle(o->phase, o->inc, p->amp, out, n); break;
+        case 4: kern->sawtooth(o->phase, o->inc, p->amp, out, n); break;
+        case WAVE_AWG: awg_render(p->table, o->phase, o->inc, p->amp, out, n); break;
+        default:
+            for (size_t i = 0; i < n; i++) out[i] = 0.0f;
+            break;
+    }
+    if (p->bandlimited) blep_correct(waveform_type, p, o->phase, o->inc, out, n);
+    dds_advance(o, n);
+}
+
+// Fills out[i] with the waveform at t = t0 + i * dt.
+// The type switch and the period math happen once per block, not per sample.
+void render_waveform_block(int waveform_type, const wave_params *p,
+                           float t0, float dt, float *out, size_t n)
+{
+    wave_gen g;
+    wave_gen_init(&g, waveform_type, p, 0, NULL, t0, dt);
+    wave_gen_render(&g, out, n);
+}
+
+// Single-sample convenience wrapper over the block renderer
+float sample_base_waveform(int waveform_type, const wave_params *p, float t)
+{
+    float y;
+    render_waveform_block(waveform_type, p, t, 0.0f, &y, 1);
+    return y;
+}
+
+/* ---------- Modulation Engine ---------- */
+
+#define MOD_CHUNK 128  // Carrier scratch per pass; keeps stack use small
+
+// Each modulator turns the normalized signal in xy into its output, in place,
+// and moves g's carrier on by n samples
+typedef void (*modulator_fn)(wave_gen *g, float *xy, size_t n);
+
+static void mod_am(wave_gen *g, float *xy, size_t n)
+{
+    STAT_BEGIN();
+    const mod_params *mod = &g->mod;
+    dds_osc *carrier = &g->carrier;
+    float c[MOD_CHUNK];
+    for (size_t i = 0; i < n; i += MOD_CHUNK) {
+        size_t k = (n - i < MOD_CHUNK) ? n - i : MOD_CHUNK;
+        kern->sine(carrier->phase, carrier->inc, 1.0f, c, k);
+        kern->am(xy + i, c, 1.0f, mod->Ac, mod->index, k);
+        dds_advance(carrier, k);
+    }
+    STAT_END(STAT_MOD_AM, n);
+}
+
+// FM phase step offset for one modulating sample. Going through int64 keeps
+// negative offsets exact; the 32-bit sum then wraps like the phase itself.
+static inline uint32_t fm_step(float dev, float x)
+{
+    return (uint32_t)(int64_t)(dev * x);
+}
+
+// Total extra carrier phase that n modulating samples add under FM
+static uint32_t fm_phase_sum(float dev, const float *x, size_t n)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += fm_step(dev, x[i]);
+    return sum;
+}
+
+static void mod_fm(wave_gen *g, float *xy, size_t n)
+{
+    // Frequency modulation: the phase step itself follows the signal,
+    // inc + dev * x, so the phase is the running integral of fc + df * x.
+    // Integer accumulation is O(1) per sample and never drifts.
+    STAT_BEGIN();
+    dds_osc *carrier = &g->carrier;
+    const float Ac = g->mod.Ac, dev = g->fm_dev;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t ph = carrier->phase;
+        carrier->phase += carrier->inc + fm_step(dev, xy[i]);
+        xy[i] = Ac * dds_sin(ph);
+    }
+    STAT_END(STAT_MOD_FM, n);
+}
+
+static void mod_pm(wave_gen *g, float *xy, size_t n)
+{
+    // Phase modulation: the signal offsets the carrier phase by beta * x rad
+    // The table lookup with a data-dependent phase stays scalar
+    STAT_BEGIN();
+    dds_osc *carrier = &g->carrier;
+    const float dev = g->mod.index / (2.0f * PI); // beta in cycles
+    for (size_t i = 0; i < n; i++) {
+        uint32_t inst_phase = carrier->phase + dds_offset(dev * xy[i]);
+        carrier->phase += carrier->inc;
+        xy[i] = g->mod.Ac * dds_sin(inst_phase);
+    }
+    STAT_END(STAT_MOD_PM, n);
+}
+
+static void mod_pwm(wave_gen *g, float *xy, size_t n)
+{
+    // Comparator against a rising ramp carrier
+    STAT_BEGIN();
+    kern->pwm(xy, g->carrier.phase, g->carrier.inc, 1.0f, g->mod.Ac, n);
+    dds_advance(&g->carrier, n);
+    STAT_END(STAT_MOD_PWM, n);
+}
+
+static const modulator_fn modulators[] = { NULL, mod_am, mod_fm, mod_pwm, mod_pm };
+
+// Peak FM step deviation: df = beta * f_mod, as a phase step per sample
+static float fm_deviation(float beta, float mod_freq, double dt)
+{
+    return (float)((double)beta * (double)mod_freq * dt * DDS_TURN);
+}
+
+void modulate_block(int mod_type, int waveform_type, const wave_params *base,
+                    const mod_params *mod, float *out, size_t n)
+{
+    wave_gen g;
+    wave_gen_init(&g, waveform_type, base, mod_type, mod, mod->t0, mod->dt);
+    wave_gen_render(&g, out, n);
+}
+
+/* ---------- Specialized Renderers ---------- */
+
+/*
+   Every (waveform x modulation) pair is expanded from the two X-macro
+   lists below into its own renderer, with the shape kernel and the
+   modulator fixed at compile time so they inline into one loop. Blocks
+   are worked in WAVE_TILE pieces: each tile of modulating signal is
+   modulated while it is still in L1. wave_gen_render() picks the
+   renderer from wave_renderers once per block.
+*/
+#define WAVE_TILE 1024
+
+#define WAVEFORM_LIST(X) \
+    X(1, sine)           \
+    X(2, square)         \
+    X(3, triangle)       \
+    X(4, sawtooth)       \
+    X(WAVE_AWG, awg)
+
+#define MODULATION_LIST(X, W, WNAME) \
+    X(W, WNAME, 0, none)             \
+    X(W, WNAME, MOD_AM, am)          \
+    X(W, WNAME, MOD_FM, fm)          \
+    X(W, WNAME, MOD_PWM, pwm)        \
+    X(W, WNAME, MOD_PM, pm)
+
+static inline void shape_sine(const wave_params *p, const dds_osc *o, float *out, size_t n)
+{
+    kern->sine(o->phase, o->inc, p->amp, out, n);
+}
+
+static inline void shape_square(const wave_params *p, const dds_osc *o, float *out, size_t n)
+{
+    kern->square(o->phase, o->inc, p->amp, p->duty, out, n);
+}
+
+static inline void shape_triangle(const wave_params *p, const dds_osc *o, float *out, size_t n)
+{
+    kern->triangle(o->phase, o->inc, p->amp, out, n);
+}
+
+static inline void shape_sawtooth(const wave_params *p, const dds_osc *o, float *out, size_t n)
+{
+    kern->sawtooth(o->phase, o->inc, p->amp, out, n);
+}
+
+static inline void shape_awg(const wave_params *p, const dds_osc *o, float *out, size_t n)
+{
+    awg_render(p->table, o->phase, o->inc, p->amp, out, n);
+}
+
+static inline void mod_none(wave_gen *g, float *xy, size_t n)
+{
+    (void)g; (void)xy; (void)n;
+}
+
+#define DEFINE_RENDERER(W, WNAME, M, MNAME)                                    \
+    static void render_##WNAME##_##MNAME(wave_gen *g, float *out, size_t n)   \
+    {                                                                          \
+        for (size_t i = 0; i < n; i += WAVE_TILE) {                            \
+            size_t k = (n - i < WAVE_TILE) ? n - i : WAVE_TILE;                \
+            shape_##WNAME(&g->shape, &g->osc, out + i, k);                     \
+            if (W != 1 && g->shape.bandlimited)                                \
+                blep_correct(W, &g->shape, g->osc.phase, g->osc.inc, out + i, k); \
+            dds_advance(&g->osc, k);                                           \
+            mod_##MNAME(g, out + i, k);                                        \
+        }                                                                      \
+    }
+#define DEFINE_RENDERERS(W, WNAME) MODULATION_LIST(DEFINE_RENDERER, W, WNAME)
+WAVEFORM_LIST(DEFINE_RENDERERS)
+
+typedef void (*wave_renderer_fn)(wave_gen *g, float *out, size_t n);
+
+#define RENDERER_ENTRY(W, WNAME, M, MNAME) [W][M] = render_##WNAME##_##MNAME,
+#define RENDERER_ROW(W, WNAME) MODULATION_LIST(RENDERER_ENTRY, W, WNAME)
+static const wave_renderer_fn wave_renderers[WAVE_AWG + 1][MOD_PM + 1] = { WAVEFORM_LIST(RENDERER_ROW) };
+
+/* ---------- Streaming Generator ---------- */
+
+void wave_gen_init(wave_gen *g, int waveform_type, const wave_params *base,
+                   int mod_type, const mod_params *mod, double t0, double dt)
+{
+    g->waveform_type = waveform_type;
+    g->dt = dt;
+    g->ramp_left = 0;
+    g->mod_type = (mod && mod_type >= MOD_AM && mod_type <= MOD_PM) ? mod_type : 0;
+    g->shape = *base;
+
+    // Square, triangle, sawtooth and the AWG are undefined without a
+    // positive frequency, the AWG also without a table
+    g->silent = waveform_type < 1 || waveform_type > WAVE_AWG ||
+                (waveform_type != 1 && base->freq <= 0.0f) ||
+                (waveform_type == WAVE_AWG && !base->table);
+
+    // Modulating signal normalized to +-1 (all zero if the base amplitude is 0)
+    if (g->mod_type) g->shape.amp = (base->amp != 0.0f) ? 1.0f : 0.0f;
+
+    double start = (double)base->freq * t0;
+    if (waveform_type == 1) start += base->phase / (2.0 * PI);
+    dds_init(&g->osc, base->freq, dt, start);
+
+    g->fm_dev = 0.0f;
+    g->fm_dev_step = 0.0f;
+    if (g->mod_type) {
+        g->mod = *mod;
+        dds_init(&g->carrier, mod->fc, dt, (double)mod->fc * t0);
+        if (g->mod_type == MOD_FM) g->fm_dev = fm_deviation(mod->index, base->freq, dt);
+    }
+    g->fm_dev_target = g->fm_dev;
+}
+
+// Renders the ramping head of a block one sample at a time; returns samples
+// done. FM is applied here too, as its deviation moves with every sample.
+static size_t wave_gen_ramp(wave_gen *g, float *out, size_t n)
+{
+    size_t k = (g->ramp_left < n) ? g->ramp_left : n;
+    for (size_t i = 0; i < k; i++) {
+        g->inc_fx += g->inc_step;
+        g->shape.amp += g->amp_step;
+        g->osc.inc = (uint32_t)(g->inc_fx >> 16);
+        render_dds_block(g->waveform_type, &g->shape, &g->osc, out + i, 1);
+        if (g->mod_type == MOD_FM) {
+            g->fm_dev += g->fm_dev_step;
+            mod_fm(g, out + i, 1);
+        }
+    }
+    g->ramp_left -= (uint32_t)k;
+    if (g->ramp_left == 0) {
+        // Land exactly on the target rather than on the accumulated steps
+        g->shape.amp = g->amp_target;
+        g->osc.inc = g->inc_target;
+        g->fm_dev = g->fm_dev_target;
+    }
+    return k;
+}
+
+void wave_gen_render(wave_gen *g, float *out, size_t n)
+{
+    STAT_BEGIN();
+    if (g->silent) {
+        for (size_t i = 0; i < n; i++) out[i] = 0.0f;
+        if (g->mod_type) modulators[g->mod_type](g, out, n);
+        STAT_END(STAT_RENDER, n);
+        return;
+    }
+    size_t head = 0;
+    if (g->ramp_left) {
+        // The ramping head goes sample by sample, the rest through the fast path
+        head = wave_gen_ramp(g, out, n);
+        if (g->mod_type && g->mod_type != MOD_FM) modulators[g->mod_type](g, out, head);
+    }
+    wave_renderers[g->waveform_type][g->mod_type](g, out + head, n - head);
+    STAT_END(STAT_RENDER, n);
+}
+
+// Skips n samples: every phase moves by n * inc, exactly as n renders would.
+// An FM carrier also owes the sum of its step offsets, so that case renders
+// the modulating signal (O(n) instead of O(1)). Only valid with no ramp in
+// progress (the pool never sees live updates).
+void wave_gen_advance(wave_gen *g, uint64_t n)
+{
+    if (g->mod_type == MOD_FM && !g->silent) {
+        float x[MOD_CHUNK];
+        for (uint64_t i = 0; i < n; ) {
+            size_t k = (n - i < MOD_CHUNK) ? (size_t)(n - i) : MOD_CHUNK;
+            render_dds_block(g->waveform_type, &g->shape, &g->osc, x, k);
+            g->carrier.phase += (uint32_t)k * g->carrier.inc + fm_phase_sum(g->fm_dev, x, k);
+            i += k;
+        }
+        return;
+    }
+    g->osc.phase += (uint32_t)n * g->osc.inc;
+    g->carrier.phase += (uint32_t)n * g->carrier.inc;
+}
+
+// Retunes a running generator without touching its phase, so the output
+// stays continuous; only a sine phase change moves the oscillator
+void wave_gen_update(wave_gen *g, const wave_update *u)
+{
+    const wave_params *p = &u->shape;
+
+    if (g->waveform_type == 1 && p->phase != g->shape.phase)
+        g->osc.phase += dds_offset((p->phase - g->shape.phase) / (2.0f * PI));
+    g->shape.phase = p->phase;
+    g->shape.duty = p->duty;
+    g->silent = g->waveform_type < 1 || g->waveform_type > WAVE_AWG ||
+                (g->waveform_type != 1 && p->freq <= 0.0f) ||
+                (g->waveform_type == WAVE_AWG && !g->shape.table);
+
+    g->amp_target = g->mod_type ? ((p->amp != 0.0f) ? 1.0f : 0.0f) : p->amp;
+    g->inc_target = dds_phase_from_cycles((double)p->freq * g->dt);
+    // The FM deviation is beta times the modulating frequency, so it must
+    // follow that frequency through the ramp rather than jump to the target
+    if (g->mod_type == MOD_FM) g->fm_dev_target = fm_deviation(u->index, p->freq, g->dt);
+    if (u->ramp == 0 || g->silent) {
+        g->ramp_left = 0;
+        g->shape.amp = g->amp_target;
+        g->osc.inc = g->inc_target;
+        g->fm_dev = g->fm_dev_target;
+    } else {
+        g->ramp_left = u->ramp;
+        g->amp_step = (g->amp_target - g->shape.amp) / (float)u->ramp;
+        g->inc_fx = (int64_t)g->osc.inc << 16;
+        g->inc_step = (((int64_t)g->inc_target << 16) - g->inc_fx) / (int64_t)u->ramp;
+        g->fm_dev_step = (g->fm_dev_target - g->fm_dev) / (float)u->ramp;
+    }
+
+    if (g->mod_type) {
+        g->mod.Ac = u->Ac;
+        g->mod.fc = u->fc;
+        g->mod.index = u->index;
+        g->carrier.inc = dds_phase_from_cycles((double)u->fc * g->dt);
+    }
+}
+
+/* ---------- Oscillator Bank ---------- */
+
+// Takes the arrays for channels silent channels from the scratch arena;
+// they live until the caller releases it. Returns 0 on failure.
+int osc_bank_init(wavegen_ctx *ctx, osc_bank *b, size_t channels, double rate, int bandlimited)
+{
+    memset(b, 0, sizeof(*b));
+    if (channels == 0 || channels > BANK_MAX_CHANNELS || rate <= 0.0) return 0;
+    b->channels = channels;
+    b->dt = 1.0 / rate;
+    b->bandlimited = bandlimited;
+    b->waveform = (int *)arena_alloc(&ctx->scratch, channels * sizeof(int));
+    b->freq = (float *)arena_alloc(&ctx->scratch, channels * sizeof(float));
+    b->amp = (float *)arena_alloc(&ctx->scratch, channels * sizeof(float));
+    b->phase = (float *)arena_alloc(&ctx->scratch, channels * sizeof(float));
+    b->duty = (float *)arena_alloc(&ctx->scratch, channels * sizeof(float));
+    b->ph = (uint32_t *)arena_alloc(&ctx->scratch, channels * sizeof(uint32_t));
+    b->inc = (uint32_t *)arena_alloc(&ctx->scratch, channels * sizeof(uint32_t));
+    b->tile = (float *)arena_alloc(&ctx->scratch, BANK_TILE * sizeof(float));
+    if (!b->waveform || !b->freq || !b->amp || !b->phase || !b->duty ||
+        !b->ph || !b->inc || !b->tile) return 0;
+    for (size_t c = 0; c < channels; c++) b->waveform[c] = 0;
+    return 1;
+}
+
+// Sets one channel and restarts its phase, as wave_gen_init would
+void osc_bank_set(osc_bank *b, size_t ch, int waveform_type, const wave_params *p)
+{
+    const int silent = waveform_type < 1 || waveform_type > 4 ||
+                       (waveform_type != 1 && p->freq <= 0.0f);
+    dds_osc o;
+    dds_init(&o, p->freq, b->dt, waveform_type == 1 ? p->phase / (2.0 * PI) : 0.0);
+
+    b->waveform[ch] = silent ? 0 : waveform_type;
+    b->freq[ch] = p->freq;
+    b->amp[ch] = p->amp;
+    b->phase[ch] = p->phase;
+    b->duty[ch] = p->duty;
+    b->ph[ch] = o.phase;
+    b->inc[ch] = o.inc;
+}
+
+// Renders frames frames of every channel: interleaved as out[frame * N + ch],
+// or planar as out[ch * frames + frame]
+void osc_bank_render(osc_bank *b, float *out, size_t frames, int layout)
+{
+    const size_t nch = b->channels;
+    for (size_t f = 0; f < frames; f += BANK_TILE) {
+        const size_t k = (frames - f < BANK_TILE) ? frames - f : BANK_TILE;
+        for (size_t c = 0; c < nch; c++) {
+            const wave_params p = { b->freq[c], b->amp[c], b->phase[c], b->duty[c], b->bandlimited, NULL };
+            dds_osc o = { b->ph[c], b->inc[c] };
+            float *dst = (layout == BANK_PLANAR) ? out + c * frames + f : b->tile;
+            render_dds_block(b->waveform[c], &p, &o, dst, k);
+            if (layout != BANK_PLANAR) {
+                float *row = out + f * nch + c;
+                for (size_t i = 0; i < k; i++) row[i * nch] = b->tile[i];
+            }
+        }
+        // One pass moves every channel on by the tile
+        for (size_t c = 0; c < nch; c++) b->ph[c] += (uint32_t)k * b->inc[c];
+    }
+}
+
+/* ---------- Frequency Sweep ---------- */
+
+// Linear law: f rises by a constant step per sample. Exponential law: f is
+// multiplied by a constant ratio per sample (equal time per octave).
+// Frequencies must lie in [0, rate), and above 0 for the exponential law.
+int wave_sweep_init(wave_sweep *w, int waveform_type, const wave_params *base,
+                    const sweep_params *sp, double rate)
+{
+    const double n = floor(sp->duration * rate + 0.5);
+    if (waveform_type < 1 || waveform_type > 4 || n < 1.0 ||
+        sp->f0 < 0.0f || sp->f1 < 0.0f || sp->f0 >= rate || sp->f1 >= rate ||
+        (sp->law == SWEEP_EXP && (sp->f0 <= 0.0f || sp->f1 <= 0.0f)))
+        return 0;
+
+    w->waveform_type = waveform_type;
+    w->shape = *base;
+    w->law = sp->law;
+    w->phase = (waveform_type == 1) ? dds_phase_from_cycles(base->phase / (2.0 * PI)) : 0;
+    w->inc = (double)sp->f0 / rate * DDS_TURN;
+    w->inc_end = (double)sp->f1 / rate * DDS_TURN;
+    w->left = (uint64_t)n;
+    w->step = (sp->law == SWEEP_EXP) ? pow((double)sp->f1 / sp->f0, 1.0 / n)
+                                     : (w->inc_end - w->inc) / n;
+    return 1;
+}
+
+// Shapes precomputed phases with the same per-sample math as the scalar kernels
+static void shape_phases(int waveform_type, const wave_params *p, const uint32_t *ph,
+                         float *out, size_t n)
+{
+    const float a = p->amp, a2 = 2.0f * a, a3 = 3.0f * a, a4 = 4.0f * a;
+    switch (waveform_type) {
+        case 1:
+            for (size_t i = 0; i < n; i++) out[i] = a * dds_sin(ph[i]);
+            break;
+        case 2:
+            for (size_t i = 0; i < n; i++) out[i] = (dds_pos(ph[i]) < p->duty) ? a : -a;
+            break;
+        case 3:
+            for (size_t i = 0; i < n; i++) {
+                float pos = dds_pos(ph[i]);
+                out[i] = (pos < 0.5f) ? -a + a4 * pos : a3 - a4 * pos;
+            }
+            break;
+        default:
+            for (size_t i = 0; i < n; i++) out[i] = -a + a2 * dds_pos(ph[i]);
+            break;
+    }
+}
+
+// Rounds a sweep step (phase units, kept in double) to the 32-bit phase circle;
+// steps at or past the sample rate wrap the way dds_phase_from_cycles does
+static inline uint32_t sweep_inc(double inc)
+{
+    const double x = inc + 0.5;
+    if (x >= 0.0 && x < DDS_TURN) return (uint32_t)x;
+    return dds_phase_from_cycles(x / DDS_TURN);
+}
+
+void wave_sweep_render(wave_sweep *w, float *out, size_t n)
+{
+    STAT_BEGIN();
+    uint32_t ph[SWEEP_TILE];
+    for (size_t i = 0; i < n; i += SWEEP_TILE) {
+        const size_t k = (n - i < SWEEP_TILE) ? n - i : SWEEP_TILE;
+        uint32_t phase = w->phase;
+        double inc = w->inc;
+        size_t j = 0;
+        // Sweeping part: one multiply-add on the step per sample
+        for (; j < k && w->left > 0; j++, w->left--) {
+            ph[j] = phase;
+            phase += sweep_inc(inc);
+            inc = (w->law == SWEEP_EXP) ? inc * w->step : inc + w->step;
+        }
+        if (w->left == 0) inc = w->inc_end;  // Land on f1 exactly, then hold it
+        const uint32_t hold = sweep_inc(inc);
+        for (; j < k; j++, phase += hold) ph[j] = phase;
+        w->phase = phase;
+        w->inc = inc;
+        shape_phases(w->waveform_type, &w->shape, ph, out + i, k);
+    }
+    STAT_END(STAT_RENDER, n);
+}
+
+/* ---------- Arbitrary Waveform Tables ---------- */
+
+// Longest level whose step is at most one entry per sample
+static int awg_level(const awg_table *t, uint32_t inc)
+{
+    int k = 0;
+    while (k + 1 < t->levels && (uint64_t)t->len[k] * inc > ((uint64_t)1 << 32)) k++;
+    return k;
+}
+
+// n samples of the table from phase on, scaled so a is the output peak.
+// phase * len is the position in entries in 32.32 fixed point.
+void awg_render(const awg_table *t, uint32_t phase, uint32_t inc, float a,
+                float *out, size_t n)
+{
+    const int k = awg_level(t, inc);
+    const float *d = t->data[k];
+    const size_t len = t->len[k];
+    const float g = a * t->gain;
+
+    switch (t->interp) {
+        case AWG_NEAREST:
+            for (size_t i = 0; i < n; i++, phase += inc) {
+                size_t j = (size_t)(((uint64_t)phase * len + 0x80000000u) >> 32);
+                out[i] = g * d[j == len ? 0 : j];
+            }
+            break;
+        case AWG_CUBIC:
+            // Catmull-Rom through the two entries either side
+            for (size_t i = 0; i < n; i++, phase += inc) {
+                const uint64_t pos = (uint64_t)phase * len;
+                const size_t j = (size_t)(pos >> 32);
+                const size_t j1 = (j + 1 < len) ? j + 1 : 0;
+                const size_t j2 = (j1 + 1 < len) ? j1 + 1 : 0;
+                const float ym = d[j ? j - 1 : len - 1], y0 = d[j], y1 = d[j1], y2 = d[j2];
+                const float f = (float)(uint32_t)pos * (1.0f / 4294967296.0f);
+                out[i] = g * (y0 + 0.5f * f * (y1 - ym + f * (2.0f * ym - 5.0f * y0 + 4.0f * y1 - y2 +
+                                                            f * (3.0f * (y0 - y1) + y2 - ym))));
+            }
+            break;
+        default:
+            for (size_t i = 0; i < n; i++, phase += inc) {
+                const uint64_t pos = (uint64_t)phase * len;
+                const size_t j = (size_t)(pos >> 32);
+                const float y0 = d[j], y1 = d[(j + 1 < len) ? j + 1 : 0];
+                out[i] = g * (y0 + (y1 - y0) * ((float)(uint32_t)pos * (1.0f / 4294967296.0f)));
+            }
+            break;
+    }
+}
+
+// Half-length copy of a period low-passed to half its Nyquist: a circular
+// Blackman-windowed halfband filter evaluated at every second entry. On a
+// short period the taps wrap more than once, which still applies the
+// filter's exact gain to each harmonic.
+static void awg_halve(const float *src, size_t n, float *dst)
+{
+    const double pi = 3.14159265358979323846;
+    double h[AWG_HALFBAND_TAPS + 1];
+    double sum = 0.5;
+    h[0] = 0.5;
+    for (int j = 1; j <= AWG_HALFBAND_TAPS; j++) {
+        const double x = (double)j / (AWG_HALFBAND_TAPS + 1);
+        const double w = 0.42 + 0.5 * cos(pi * x) + 0.08 * cos(2.0 * pi * x);
+        h[j] = (j & 1) ? sin(pi * j / 2.0) / (pi * j) * w : 0.0;
+        sum += 2.0 * h[j];
+    }
+    for (size_t i = 0; i < n / 2; i++) {
+        double acc = h[0] * src[2 * i];
+        for (size_t j = 1; j <= AWG_HALFBAND_TAPS; j += 2)
+            acc += h[j] * ((double)src[(2 * i + j) % n] + src[(2 * i + n - j % n) % n]);
+        dst[i] = (float)(acc / sum);
+    }
+}
+
+// Table over one period of len entries at data, which the caller keeps
+// (arena or file mapping) for as long as the table plays; the mipmaps go
+// into ctx's arena. Returns 0 if the period is empty, longer than
+// AWG_MAX_LEN entries or not finite.
+int awg_build(wavegen_ctx *ctx, awg_table *t, const float *data, size_t len,
+              int interp, int mipmap)
+{
+    memset(t, 0, sizeof(*t));
+    t->interp = interp;
+
+    float peak = 0.0f;
+    for (size_t i = 0; data && i < len; i++) {
+        if (!isfinite(data[i])) data = NULL;
+        else if (fabsf(data[i]) > peak) peak = fabsf(data[i]);
+    }
+    if (!data || len == 0 || len > AWG_MAX_LEN) return 0;
+
+    t->gain = (peak > 0.0f) ? 1.0f / peak : 0.0f;
+    t->levels = 1;
+    t->len[0] = len;
+    t->data[0] = data;
+    while (mipmap && t->levels < AWG_MAX_LEVELS) {
+        const size_t n = t->len[t->levels - 1];
+        if (n % 2 || n / 2 < AWG_MIN_LEVEL_LEN) break;
+        float *half = (float *)arena_alloc(&ctx->scratch, n / 2 * sizeof(float));
+        if (!half) break;  // Fewer levels; playback takes the shortest there is
+        awg_halve(t->data[t->levels - 1], n, half);
+        t->len[t->levels] = n / 2;
+        t->data[t->levels] = half;
+        t->levels++;
+    }
+    ctx->cache_version++;  // A cache may hold a period of an earlier table at this address
+    return 1;
+}
+
+/* ---------- Oversampling Decimator ---------- */
+
+// Modified Bessel function of the first kind, order 0 (Kaiser window)
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 100 && term > 1e-15 * sum; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed halfband for a stage whose input runs at 2^q times the
+// output rate. The band up to OVERSAMPLE_PASSBAND of the output rate must
+// pass and whatever folds onto it must be stopband_db down, which leaves
+// 0.5 - 2 * passband / 2^q of the input rate for the transition: narrow
+// at the last stage, wide (so the filter is short) further up
+static size_t halfband_design(int q, double stopband_db, float *c)
+{
+    const double pi = 3.14159265358979323846;
+    const double width = 0.5 - 2.0 * OVERSAMPLE_PASSBAND / (double)(1 << q);
+    const double A = stopband_db;
+    const double beta = A > 50.0 ? 0.1102 * (A - 8.7)
+                      : (A > 21.0 ? 0.5842 * pow(A - 21.0, 0.4) + 0.07886 * (A - 21.0) : 0.0);
+    const double order = (A - 7.95) / (14.357 * width);  // Kaiser's length estimate
+    size_t taps = (size_t)ceil((order + 2.0) / 4.0);
+    if (taps < 1) taps = 1;
+    if (taps > HALFBAND_MAX_TAPS) taps = HALFBAND_MAX_TAPS;
+
+    // Nonzero taps sit at odd offsets 1, 3, ... 2 * taps - 1 from the centre
+    double h[HALFBAND_MAX_TAPS];
+    const double reach = 2.0 * (double)taps - 1.0;
+    double sum = 0.0;
+    for (size_t t = 0; t < taps; t++) {
+        const double k = 2.0 * (double)t + 1.0;
+        const double r = k / reach;
+        h[t] = sin(pi * k / 2.0) / (pi * k) * bessel_i0(beta * sqrt(1.0 - r * r)) / bessel_i0(beta);
+        sum += h[t];
+    }
+    // Unity gain at DC: centre 0.5 plus both wings
+    for (size_t t = 0; t < taps; t++) c[t] = (float)(h[t] * 0.25 / sum);
+    return taps;
+}
+
+// Cascade for ratio (a power of two up to OVERSAMPLE_MAX) with room for
+// max_in input samples per call. Histories start at zero.
+int decimator_init(wavegen_ctx *ctx, decimator *d, int ratio, double stopband_db, size_t max_in)
+{
+    memset(d, 0, sizeof(*d));
+    if (ratio < 1 || ratio > OVERSAMPLE_MAX || (ratio & (ratio - 1)) || max_in % (size_t)ratio)
+        return 0;
+    d->ratio = ratio;
+    d->max_in = max_in;
+    while ((1 << d->stages) < ratio) d->stages++;
+
+    size_t n = max_in;
+    for (int s = 0; s < d->stages; s++, n /= 2) {
+        halfband_stage *st = &d->st[s];
+        st->taps = halfband_design(d->stages - s, stopband_db, st->c);
+        const size_t he = 2 * st->taps - 1, ho = st->taps;
+        st->e = (float *)arena_alloc(&ctx->scratch, (he + n / 2) * sizeof(float));
+        st->o = (float *)arena_alloc(&ctx->scratch, (ho + n / 2) * sizeof(float));
+        if (!st->e || !st->o) return 0;
+        memset(st->e, 0, he * sizeof(float));
+        memset(st->o, 0, ho * sizeof(float));
+        // Stage s delays by he of its own inputs, 2^s inputs of the cascade each
+        d->delay += he << s;
+    }
+    return 1;
+}
+
+// Decimates n input samples (a multiple of the ratio, at most max_in) into
+// n / ratio outputs; x is scratch for the stages and may also be out
+void decimator_run(decimator *d, float *x, size_t n, float *out)
+{
+    if (d->stages == 0) {
+        memmove(out, x, n * sizeof(float));
+        return;
+    }
+    for (int s = 0; s < d->stages; s++, n /= 2) {
+        halfband_stage *st = &d->st[s];
+        const size_t he = 2 * st->taps - 1, ho = st->taps, h = n / 2;
+        // Split into the two polyphase branches behind the history
+        for (size_t m = 0; m < h; m++) {
+            st->e[he + m] = x[2 * m];
+            st->o[ho + m] = x[2 * m + 1];
+        }
+        kern->halfband(st->e, st->o, st->c, st->taps, (s + 1 == d->stages) ? out : x, h);
+        memmove(st->e, st->e + h, he * sizeof(float));
+        memmove(st->o, st->o + h, ho * sizeof(float));
+    }
+}
+
+/* ---------- Precise PWM ---------- */
+
+// Modulating value at the end of the current period; the phase then
+// steps on by one carrier period
+static float pwm_sample_mod(pwm_engine *e)
+{
+    float x = 0.0f;
+    if (!e->silent) render_dds_block(e->waveform_type, &e->shape, &e->mod, &x, 1);
+    else dds_advance(&e->mod, 1);
+    return x;
+}
+
+// Where the modulating signal, taken as a straight line from x0 to x1
+// across the period, meets the carrier ramp rising from -1 to 1: the
+// fraction of the period the comparator output stays high
+static double pwm_duty(float x0, float x1)
+{
+    const double den = 2.0 - ((double)x1 - (double)x0);
+    double d = (den > 0.0) ? ((double)x0 + 1.0) / den : (x0 > -1.0f ? 1.0 : 0.0);
+    return d < 0.0 ? 0.0 : (d > 1.0 ? 1.0 : d);
+}
+
+// Moves on to the next carrier period
+static void pwm_next_period(pwm_engine *e)
+{
+    const float x0 = e->x_next;
+    e->x_next = pwm_sample_mod(e);
+    e->duty = pwm_duty(x0, e->x_next);
+    e->k++;
+}
+
+// Carrier fc on a time grid of rate points per second (output samples, or
+// timer ticks for compare values); the modulating signal is base, as for
+// the sample-by-sample comparator. A band-limited engine smooths its edges
+// with PolyBLEP residuals and records up to edge_cap of them per block
+// (frames + 8 covers any block of frames samples).
+int pwm_engine_init(pwm_engine *e, int waveform_type, const wave_params *base, float Ac,
+                    double fc, double rate, pwm_edge *edges, size_t edge_cap)
+{
+    memset(e, 0, sizeof(*e));
+    if (fc <= 0.0 || rate / fc < 2.0) return 0;  // Two samples per period at least
+    e->waveform_type = waveform_type;
+    e->silent = waveform_type < 1 || waveform_type > WAVE_AWG ||
+                (waveform_type != 1 && base->freq <= 0.0f) ||
+                (waveform_type == WAVE_AWG && !base->table);
+    e->shape = *base;
+    e->shape.amp = (base->amp != 0.0f) ? 1.0f : 0.0f;
+    e->shape.bandlimited = 0;  // Sampled once per period, so its own edges do not matter
+    e->Ac = Ac;
+    e->period = rate / fc;
+    e->bandlimited = base->bandlimited && edges;
+    e->edges = edges;
+    e->edge_cap = edge_cap;
+
+    double start = 0.0;
+    if (waveform_type == 1) start = base->phase / (2.0 * PI);
+    dds_init(&e->mod, base->freq, 1.0 / fc, start);
+    const float x0 = pwm_sample_mod(e);
+    e->x_next = pwm_sample_mod(e);
+    e->duty = pwm_duty(x0, e->x_next);
+    return 1;
+}
+
+// Duty cycle of the next carrier period (0..1), one per call
+double pwm_engine_next_duty(pwm_engine *e)
+{
+    const double d = e->duty;
+    pwm_next_period(e);
+    return d;
+}
+
+// Records an edge of height h (+Ac rising, -Ac falling) at block time t
+static void pwm_add_edge(pwm_engine *e, double t, float h, size_t *count)
+{
+    if (!e->bandlimited || *count >= e->edge_cap) return;
+    const double j = floor(t);
+    pwm_edge *g = &e->edges[(*count)++];
+    g->j = (size_t)j;
+    g->d = (float)(t - j);
+    g->h = h;
+}
+
+// Renders n samples: Ac from each period start up to the falling edge at
+// start + duty * period, -Ac after it. Edge times are exact, so the duty
+// resolution does not depend on the sample rate. Each edge costs a
+// residual on the two samples around it (the second may be out[0] of the
+// next block), with the same 2-sample PolyBLEP as the band-limited shapes.
+void pwm_engine_render(pwm_engine *e, float *out, size_t n)
+{
+    STAT_BEGIN();
+    const float hi = e->Ac, lo = -e->Ac;
+    const double origin = (double)e->origin;
+    size_t edges = 0;
+
+    for (size_t j = 0; j < n; ) {
+        const double s = (double)e->k * e->period - origin;
+        const double f = s + e->duty * e->period;
+        const double next = s + e->period;
+        if (e->k > 0 && s >= 0.0 && s < (double)n) pwm_add_edge(e, s, hi, &edges);
+        if (f >= 0.0 && f < (double)n) pwm_add_edge(e, f, lo, &edges);
+
+        const size_t to_fall = (f <= 0.0) ? 0 : (f >= (double)n ? n : (size_t)ceil(f));
+        const size_t to_next = (next >= (double)n) ? n : (size_t)ceil(next);
+        for (; j < to_fall && j < to_next; j++) out[j] = hi;
+        for (; j < to_next; j++) out[j] = lo;
+        if (next <= (double)n) pwm_next_period(e);
+        if (j >= n) break;
+    }
+
+    if (e->bandlimited) {
+        // Residuals of a step scaled like poly_blep: the sample at or past
+        // the edge is pulled back, the one before it pushed forward. Edges
+        // at the end of the last block still owe out[0] their second one
+        for (int c = 0; c < e->carried; c++) out[0] -= e->carry[c].h * e->carry[c].d * e->carry[c].d;
+        e->carried = 0;
+        for (size_t i = 0; i < edges; i++) {
+            const pwm_edge *g = &e->edges[i];
+            const float r = (1.0f - g->d) * (1.0f - g->d);
+            out[g->j] += (g->d > 0.0f) ? g->h * r : -g->h;
+            if (g->j + 1 < n) out[g->j + 1] -= g->h * g->d * g->d;
+            else if (e->carried < PWM_MAX_CARRY) e->carry[e->carried++] = *g;
+        }
+    }
+    e->origin += n;
+    STAT_END(STAT_MOD_PWM, n);
+}
+
+/* ---------- Spectrum Analysis ---------- */
+
+/*
+   The real FFT runs as an n/2-point complex FFT of the sample pairs
+   (x[2j] + i x[2j+1]) and a split step that separates the two halves.
+   The complex FFT works in place on split re/im arrays: bit reversal, one
+   radix-4 pass (twiddles 1 and -i, so no multiplies) and then radix-2
+   passes whose butterflies go through the kernel table, each pass with
+   its own contiguous twiddle run so the SIMD loads stay sequential.
+*/
+
+int fft_plan_init(wavegen_ctx *ctx, fft_plan *p, size_t n)
+{
+    const double pi = 3.14159265358979323846;
+    const size_t m = n / 2;
+    memset(p, 0, sizeof(*p));
+    if (n < ANALYZE_MIN_FFT || n > ANALYZE_MAX_FFT || (n & (n - 1))) return 0;
+    p->n = n;
+    p->tw_re = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    p->tw_im = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    p->rt_re = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    p->rt_im = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    if (!p->tw_re || !p->tw_im || !p->rt_re || !p->rt_im) return 0;
+
+    for (size_t h = 1; h < m; h <<= 1) {
+        for (size_t j = 0; j < h; j++) {
+            p->tw_re[h - 1 + j] = (float)cos(pi * (double)j / (double)h);
+            p->tw_im[h - 1 + j] = (float)-sin(pi * (double)j / (double)h);
+        }
+    }
+    for (size_t k = 0; k < m; k++) {
+        p->rt_re[k] = (float)cos(2.0 * pi * (double)k / (double)n);
+        p->rt_im[k] = (float)-sin(2.0 * pi * (double)k / (double)n);
+    }
+    return 1;
+}
+
+static void fft_complex(const fft_plan *p, float *re, float *im)
+{
+    const size_t m = p->n / 2;
+    for (size_t i = 1, j = 0; i < m; i++) {
+        size_t bit = m >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    // First two radix-2 passes as one radix-4 pass
+    for (size_t g = 0; g < m; g += 4) {
+        const float r0 = re[g] + re[g + 1], i0 = im[g] + im[g + 1];
+        const float r1 = re[g] - re[g + 1], i1 = im[g] - im[g + 1];
+        const float r2 = re[g + 2] + re[g + 3], i2 = im[g + 2] + im[g + 3];
+        const float r3 = re[g + 2] - re[g + 3], i3 = im[g + 2] - im[g + 3];
+        re[g] = r0 + r2;     im[g] = i0 + i2;
+        re[g + 2] = r0 - r2; im[g + 2] = i0 - i2;
+        re[g + 1] = r1 + i3; im[g + 1] = i1 - r3;  // r3 + i i3 times -i
+        re[g + 3] = r1 - i3; im[g + 3] = i1 + r3;
+    }
+    for (size_t h = 4; h < m; h <<= 1) {
+        for (size_t g = 0; g < m; g += 2 * h)
+            kern->butterfly(re + g, im + g, re + g + h, im + g + h, p->tw_re + h - 1, p->tw_im + h - 1, h);
+    }
+}
+
+// In place: re/im hold the n/2 pairs x[2j], x[2j+1] and come back as
+// X[k] for k < n/2, except that im[0] holds the real X[n/2]
+void fft_real(const fft_plan *p, float *re, float *im)
+{
+    const size_t m = p->n / 2;
+    fft_complex(p, re, im);
+
+    const float z0r = re[0], z0i = im[0];
+    re[0] = z0r + z0i;
+    im[0] = z0r - z0i;
+    for (size_t k = 1; k <= m / 2; k++) {
+        const size_t q = m - k;
+        const float ar = re[k], ai = im[k], br = re[q], bi = im[q];
+        // Even and odd halves of bin k: (Z[k] + conj Z[q]) / 2, (Z[k] - conj Z[q]) / 2i
+        const float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+        const float or_ = 0.5f * (ai + bi), oi = -0.5f * (ar - br);
+        const float cr = p->rt_re[k], ci = p->rt_im[k];
+        re[k] = er + cr * or_ - ci * oi;
+        im[k] = ei + cr * oi + ci * or_;
+        if (q != k) {
+            // Bin q from the same pair: its odd half is the conjugate mirror
+            const float dr = p->rt_re[q], di = p->rt_im[q];
+            const float qr = or_, qi = -oi;
+            re[q] = er + dr * qr - di * qi;
+            im[q] = -ei + dr * qi + di * qr;
+        }
+    }
+}
+
+static double spectrum_db(double ratio)
+{
+    return (ratio > 0.0) ? 10.0 * log10(ratio) : -999.0;
+}
+
+// Sum of the unmarked bins in [k - ANALYZE_LOBE, k + ANALYZE_LOBE], which
+// are then marked
+static double spectrum_take(const double *power, unsigned char *mark, size_t bins, size_t k)
+{
+    double sum = 0.0;
+    const size_t lo = (k > ANALYZE_LOBE) ? k - ANALYZE_LOBE : 0;
+    const size_t hi = (k + ANALYZE_LOBE < bins) ? k + ANALYZE_LOBE : bins - 1;
+    for (size_t j = lo; j <= hi; j++) {
+        if (!mark[j]) sum += power[j];
+        mark[j] = 1;
+    }
+    return sum;
+}
+
+/*
+   Analyzes the first power-of-two run of x (at most ANALYZE_MAX_FFT).
+   Power per bin is scaled so a tone's lobe sums to its mean square; the
+   noise is everything outside DC, the fundamental and its harmonics,
+   scaled up to the whole band. If db is given it receives n/2 + 1 bin
+   levels in dB relative to the fundamental's peak bin.
+*/
+int spectrum_analyze(wavegen_ctx *ctx, const float *x, size_t n, double rate,
+                     spectrum_report *r, float *db)
+{
+    size_t len = ANALYZE_MAX_FFT;
+    while (len > n) len >>= 1;
+    memset(r, 0, sizeof(*r));
+    r->n = len;
+    r->rate = rate;
+
+    const size_t mark0 = arena_mark(&ctx->scratch);
+    const size_t m = len / 2, bins = m + 1;
+    fft_plan plan;
+    float *re = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    float *im = (float *)arena_alloc(&ctx->scratch, m * sizeof(float));
+    double *power = (double *)arena_alloc(&ctx->scratch, bins * sizeof(double));
+    unsigned char *mark = (unsigned char *)arena_alloc(&ctx->scratch, bins);
+    if (!re || !im || !power || !mark || !fft_plan_init(ctx, &plan, len)) {
+        arena_release(&ctx->scratch, mark0);
+        return 0;
+    }
+
+    // 7-term Blackman-Harris window: sidelobes below -180 dB, so leakage
+    // stays under the float FFT's own noise; main lobe +-7 bins. Each
+    // cos(2 pi k i / len) is a lookup in the split-step table.
+    static const double bh7[7] = {
+        0.27105140069342, -0.43329793923448, 0.21812299954311, -0.06592544638803,
+        0.01081174209837, -0.00077658482522, 0.00001388721735
+    };
+    double sum = 0.0, w2 = 0.0;
+    for (size_t i = 0; i < len; i++) {
+        double w = bh7[0];
+        for (size_t k = 1; k < 7; k++) {
+            const size_t j = (k * i) & (len - 1);
+            w += bh7[k] * ((j < m) ? plan.rt_re[j] : -plan.rt_re[j - m]);
+        }
+        const float v = x[i] * (float)w;
+        if (i & 1) im[i / 2] = v;
+        else re[i / 2] = v;
+        sum += x[i];
+        w2 += w * w;
+    }
+    r->dc = sum / (double)len;
+    fft_real(&plan, re, im);
+
+    const double scale = 2.0 / ((double)len * w2);
+    power[0] = 0.5 * scale * (double)re[0] * re[0];
+    power[m] = 0.5 * scale * (double)im[0] * im[0];
+    for (size_t k = 1; k < m; k++) power[k] = scale * ((double)re[k] * re[k] + (double)im[k] * im[k]);
+
+    // DC, then the fundamental: the strongest remaining bin
+    memset(mark, 0, bins);
+    spectrum_take(power, mark, bins, 0);
+    size_t kf = ANALYZE_LOBE + 1;
+    for (size_t k = kf; k < bins; k++) {
+        if (power[k] > power[kf]) kf = k;
+    }
+    const size_t lo = kf - ANALYZE_LOBE, hi = (kf + ANALYZE_LOBE < bins) ? kf + ANALYZE_LOBE : bins - 1;
+    double moment = 0.0;
+    for (size_t k = lo; k <= hi; k++) moment += (double)k * power[k];
+    const double pf = spectrum_take(power, mark, bins, kf);
+    const double bin_hz = rate / (double)len;
+    r->f0 = (pf > 0.0) ? moment / pf * bin_hz : 0.0;
+    r->amp = sqrt(2.0 * pf);
+
+    // Harmonics at multiples of the measured frequency
+    double ph = 0.0;
+    for (int h = 2; h <= ANALYZE_HARMONICS; h++) {
+        const double kh = h * r->f0 / bin_hz;
+        r->harm_dbc[h] = -1000.0;
+        if (kh + 0.5 >= (double)bins) continue;
+        const double p = spectrum_take(power, mark, bins, (size_t)(kh + 0.5));
+        r->harm_dbc[h] = spectrum_db(p / pf);
+        ph += p;
+    }
+
+    // Noise: the unmarked bins, stretched over the marked ones; the largest
+    // bin outside DC and the fundamental's lobe is the worst spur
+    double noise = 0.0, spur = 0.0;
+    size_t free_bins = 0;
+    for (size_t k = 0; k < bins; k++) {
+        if (!mark[k]) {
+            noise += power[k];
+            free_bins++;
+        }
+        if ((k < lo || k > hi) && k > ANALYZE_LOBE && power[k] > spur) spur = power[k];
+    }
+    if (free_bins) noise *= (double)(bins - ANALYZE_LOBE - 1) / (double)free_bins;
+
+    r->thd_pct = (pf > 0.0) ? 100.0 * sqrt(ph / pf) : 0.0;
+    r->thd_db = spectrum_db(ph / pf);
+    r->snr_db = spectrum_db(pf / noise);
+    r->sinad_db = spectrum_db(pf / (noise + ph));
+    r->sfdr_db = spectrum_db(power[kf] / spur);
+    r->enob = (r->sinad_db - 1.76) / 6.02;
+
+    if (db) {
+        for (size_t k = 0; k < bins; k++) db[k] = (float)spectrum_db(power[k] / power[kf]);
+    }
+    arena_release(&ctx->scratch, mark0);
+    return 1;
+}
+
+/* ---------- Period Cache ---------- */
+
+// Samples per period if one period is a whole number of samples, else 0
+size_t wave_cache_exact_period(const wave_params *p, double rate)
+{
+    if (p->freq <= 0.0f) return 0;
+    double q = rate / (double)p->freq;
+    double r = floor(q + 0.5);
+    if (r < 1.0 || r > WAVE_CACHE_MAX_PERIOD || fabs(q - r) > 1e-9 * q) return 0;
+    return (size_t)r;
+}
+
+static int wave_cache_hit(const wave_cache *c, unsigned version, int waveform_type,
+                          const wave_params *p, double dt, size_t period, size_t min_len)
+{
+    return c->valid && c->version == version &&
+           c->waveform_type == waveform_type && c->dt == dt &&
+           c->period == period && c->len >= min_len &&
+           c->p.freq == p->freq && c->p.amp == p->amp &&
+           c->p.phase == p->phase && c->p.duty == p->duty &&
+           c->p.bandlimited == p->bandlimited && c->p.table == p->table;
+}
+
+// Empty cache over caller storage; min_len + period samples fit any request
+void wave_cache_init(wave_cache *c, float *buf, size_t cap)
+{
+    memset(c, 0, sizeof(*c));
+    c->buf = buf;
+    c->cap = buf ? cap : 0;
+}
+
+// Returns at least min_len samples of the waveform from t = 0, built by
+// rendering one period and repeating it. NULL if the storage is too small.
+const float *wave_cache_get(const wavegen_ctx *ctx, wave_cache *c, int waveform_type,
+                            const wave_params *p, double dt, size_t period, size_t min_len)
+{
+    if (wave_cache_hit(c, ctx->cache_version, waveform_type, p, dt, period, min_len)) return c->buf;
+
+    size_t reps = (min_len + period - 1) / period;
+    if (reps < 1) reps = 1;
+    size_t len = reps * period;
+    if (len > c->cap) return NULL;
+
+    wave_gen g;
+    wave_gen_init(&g, waveform_type, p, 0, NULL, 0.0, dt);
+    wave_gen_render(&g, c->buf, period);
+    // Doubling copies: log2(reps) memcpy calls fill the tile
+    for (size_t have = period; have < len; ) {
+        size_t k = (len - have < have) ? len - have : have;
+        memcpy(c->buf + have, c->buf, k * sizeof(float));
+        have += k;
+    }
+
+    c->valid = 1;
+    c->version = ctx->cache_version;
+    c->waveform_type = waveform_type;
+    c->p = *p;
+    c->dt = dt;
+    c->period = period;
+    c->len = len;
+    return c->buf;
+}
+
+/* ---------- Parallel Renderer ---------- */
+
+int default_thread_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    return (n > POOL_MAX_THREADS) ? POOL_MAX_THREADS : (int)n;
+}
+
+/* What a pool job does with each chunk. Plain renders need one pass. FM
+   needs two, because a chunk's carrier phase depends on every modulating
+   sample before it: first each chunk renders its modulating signal and
+   sums its phase step offsets, then a serial prefix sum over the chunks
+   gives each carrier its start phase, then the carriers run in parallel */
+enum { POOL_RENDER, POOL_FM_SIGNAL, POOL_FM_CARRIER };
+
+static void pool_chunk(render_pool *p, size_t c, size_t start, size_t len)
+{
+    const wave_gen *origin = p->origin;
+    float *out = p->out + start;
+    wave_gen g = *origin;
+
+    switch (p->pass) {
+        case POOL_RENDER:
+            // The chunk's starting phase follows directly from its sample index
+            wave_gen_advance(&g, start);
+            wave_gen_render(&g, out, len);
+            break;
+        case POOL_FM_SIGNAL:
+            g.osc.phase += (uint32_t)start * g.osc.inc;
+            render_dds_block(g.waveform_type, &g.shape, &g.osc, out, len);
+            p->fm_base[c] = fm_phase_sum(g.fm_dev, out, len);
+            break;
+        case POOL_FM_CARRIER:
+            g.carrier.phase = p->fm_base[c];
+            mod_fm(&g, out, len);
+            break;
+    }
+}
+
+// Takes chunks until none are left; called with the lock held, returns with it held
+static void pool_drain(render_pool *p)
+{
+    while (p->next_chunk < p->chunks) {
+        size_t c = p->next_chunk++;
+        size_t start = c * POOL_CHUNK;
+        size_t len = (p->n - start < POOL_CHUNK) ? p->n - start : POOL_CHUNK;
+        pthread_mutex_unlock(&p->lock);
+
+        pool_chunk(p, c, start, len);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->pending == 0) pthread_cond_signal(&p->work_done);
+    }
+}
+
+static void *pool_worker(void *arg)
+{
+    render_pool *p = (render_pool *)arg;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (p->generation == seen && !p->shutdown) pthread_cond_wait(&p->work_ready, &p->lock);
+        if (p->shutdown) break;
+        seen = p->generation;
+        pool_drain(p);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// Starts nthreads - 1 workers (the calling thread is the last one); returns 0 on failure
+int render_pool_start(wavegen_ctx *ctx, render_pool *p, int nthreads)
+{
+    memset(p, 0, sizeof(*p));
+    if (nthreads > POOL_MAX_THREADS) nthreads = POOL_MAX_THREADS;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->work_ready, NULL);
+    pthread_cond_init(&p->work_done, NULL);
+
+    // FM keeps one phase per chunk of the largest block, from the arena
+    p->fm_cap = PARALLEL_BLOCK / POOL_CHUNK + 1;
+    p->fm_base = (uint32_t *)arena_alloc(&ctx->scratch, p->fm_cap * sizeof(uint32_t));
+    if (!p->fm_base) p->fm_cap = 0;
+
+    for (int i = 0; i < nthreads - 1; i++) {
+        if (pthread_create(&p->threads[i], NULL, pool_worker, p) != 0) {
+            render_pool_stop(p);
+            return 0;
+        }
+        p->nthreads++;
+    }
+    return 1;
+}
+
+// Runs one pass over every chunk; blocks until all of them are done
+static void pool_run(render_pool *p, const wave_gen *origin, int pass, float *out, size_t n)
+{
+    pthread_mutex_lock(&p->lock);
+    p->origin = origin;
+    p->pass = pass;
+    p->out = out;
+    p->n = n;
+    p->next_chunk = 0;
+    p->chunks = (n + POOL_CHUNK - 1) / POOL_CHUNK;
+    p->pending = p->chunks;
+    p->generation++;
+    pthread_cond_broadcast(&p->work_ready);
+
+    pool_drain(p);
+    while (p->pending > 0) pthread_cond_wait(&p->work_done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+// Renders n samples from g's state and leaves g after them, like wave_gen_render
+void render_pool_render(render_pool *p, wave_gen *g, float *out, size_t n)
+{
+    if (g->mod_type != MOD_FM || g->silent) {
+        pool_run(p, g, POOL_RENDER, out, n);
+        wave_gen_advance(g, n);
+        return;
+    }
+
+    size_t chunks = (n + POOL_CHUNK - 1) / POOL_CHUNK;
+    if (chunks > p->fm_cap) {
+        wave_gen_render(g, out, n);  // Serial fallback
+        return;
+    }
+
+    pool_run(p, g, POOL_FM_SIGNAL, out, n);
+    uint32_t phase = g->carrier.phase;
+    for (size_t c = 0; c < chunks; c++) {
+        size_t len = (c + 1 < chunks) ? POOL_CHUNK : n - c * POOL_CHUNK;
+        uint32_t offsets = p->fm_base[c];
+        p->fm_base[c] = phase;
+        phase += (uint32_t)len * g->carrier.inc + offsets;
+    }
+    pool_run(p, g, POOL_FM_CARRIER, out, n);
+
+    g->osc.phase += (uint32_t)n * g->osc.inc;
+    g->carrier.phase = phase;
+}
+
+void render_pool_stop(render_pool *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->work_ready);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->nthreads; i++) pthread_join(p->threads[i], NULL);
+    p->nthreads = 0;
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->work_ready);
+    pthread_cond_destroy(&p->work_done);
+    p->fm_base = NULL;
+}
+
+/* ---------- Streaming Engine ---------- */
+
+// Free space for the producer; acquire pairs with the consumer's release of tail
+static inline size_t ring_space(spsc_ring *r, size_t head)
+{
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return r->capacity - (head - tail);
+}
+
+void sleep_ns(long ns)
+{
+    struct timespec ts = { ns / 1000000000L, ns % 1000000000L };
+    nanosleep(&ts, NULL);
+}
+
+// Control side: copy into the private slot, then swap it into the middle
+static void mailbox_publish(param_mailbox *m, const wave_update *u)
+{
+    m->slot[m->back] = *u;
+    unsigned prev = atomic_exchange_explicit(&m->middle, m->back | MAILBOX_FRESH,
+                                             memory_order_acq_rel);
+    m->back = prev & 3u;
+}
+
+// Audio side: returns the newest unread update, or NULL if nothing changed
+static const wave_update *mailbox_fetch(param_mailbox *m)
+{
+    if (!(atomic_load_explicit(&m->middle, memory_order_relaxed) & MAILBOX_FRESH))
+        return NULL;
+    unsigned prev = atomic_exchange_explicit(&m->middle, m->front, memory_order_acq_rel);
+    m->front = prev & 3u;
+    return &m->slot[m->front];
+}
+
+// Safe from one control thread while the producer runs
+void stream_update(stream_engine *e, const wave_update *u)
+{
+    mailbox_publish(&e->params, u);
+}
+
+static void *stream_producer(void *arg)
+{
+    stream_engine *e = (stream_engine *)arg;
+    spsc_ring *r = &e->ring;
+    uint64_t produced = 0;
+    int stalled = 0;
+
+    while (atomic_load_explicit(&e->running, memory_order_relaxed)) {
+        if (e->total && produced >= e->total) break;
+
+        size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        if (ring_space(r, head) < STREAM_BLOCK) {
+            // Ring full: count the episode once, then let the consumer catch up
+            if (!stalled) {
+                atomic_fetch_add_explicit(&r->overruns, 1, memory_order_relaxed);
+                STAT_COUNT(STAT_OVERRUN);
+            }
+            stalled = 1;
+            sleep_ns(20000);
+            continue;
+        }
+        stalled = 0;
+
+        // Writes are whole blocks and the capacity is a multiple of the block,
+        // so a block never wraps and can be rendered straight into the ring
+        // Parameter changes land on block boundaries only
+        const wave_update *u = mailbox_fetch(&e->params);
+        if (u) wave_gen_update(&e->gen, u);
+
+        size_t n = STREAM_BLOCK;
+        if (e->total && e->total - produced < n) n = (size_t)(e->total - produced);
+        wave_gen_render(&e->gen, r->buf + (head & (r->capacity - 1)), n);
+        produced += n;
+        atomic_store_explicit(&r->head, head + n, memory_order_release);
+    }
+    return NULL;
+}
+
+// Allocates the ring and starts the producer; returns 0 on failure
+int stream_start(wavegen_ctx *ctx, stream_engine *e, const wave_gen *g, uint64_t total)
+{
+    memset(e, 0, sizeof(*e));
+    e->ring.capacity = (size_t)STREAM_BLOCK * STREAM_RING_BLOCKS;
+    e->ring.buf = (float *)arena_alloc(&ctx->scratch, e->ring.capacity * sizeof(float));
+    if (!e->ring.buf) return 0;
+    atomic_init(&e->ring.head, 0);
+    atomic_init(&e->ring.tail, 0);
+    atomic_init(&e->ring.underruns, 0);
+    atomic_init(&e->ring.overruns, 0);
+    e->params.front = 0;
+    e->params.back = 2;
+    atomic_init(&e->params.middle, 1);
+    e->gen = *g;
+    e->total = total;
+    atomic_init(&e->running, 1);
+
+    if (pthread_create(&e->producer, NULL, stream_producer, e) != 0) {
+        e->ring.buf = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Consumer side, safe for an audio callback: never blocks, locks or allocates.
+// Copies up to n samples, pads a shortfall with silence and counts an underrun.
+// Returns the number of real samples delivered.
+size_t stream_read(stream_engine *e, float *dst, size_t n)
+{
+    spsc_ring *r = &e->ring;
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t avail = head - tail;
+    size_t k = (avail < n) ? avail : n;
+    size_t pos = tail & (r->capacity - 1);
+    size_t first = (r->capacity - pos < k) ? r->capacity - pos : k;
+
+    memcpy(dst, r->buf + pos, first * sizeof(float));
+    memcpy(dst + first, r->buf, (k - first) * sizeof(float));
+    atomic_store_explicit(&r->tail, tail + k, memory_order_release);
+
+    if (k < n) {
+        memset(dst + k, 0, (n - k) * sizeof(float));
+        atomic_fetch_add_explicit(&r->underruns, 1, memory_order_relaxed);
+        STAT_COUNT(STAT_UNDERRUN);
+    }
+    return k;
+}
+
+void stream_stop(stream_engine *e)
+{
+    atomic_store_explicit(&e->running, 0, memory_order_relaxed);
+    pthread_join(e->producer, NULL);
+    e->ring.buf = NULL;
+}
+
+/* ---------- Fixed-Point (Q15) Path ---------- */
+
+#if WAVEGEN_FIXED_POINT
+/*
+   Error against the float path after its s16 conversion, from
+   --fixed-check (1M samples per case, 48 kHz, 1 V full scale):
+     square                   <= 1 LSB
+     sine, sawtooth           <= 2 LSB (table entry and product rounding;
+                                       interpolation adds ~0.01 LSB)
+     triangle, any + AM       <= 3 LSB (one more rounded product)
+     PWM                      levels match; an edge may move by one sample
+                              where the signal is within 1 LSB of the ramp
+   3 LSB is 9e-5 of full scale (-81 dBFS). FM, PM and --quality blep stay
+   on the float path.
+*/
+
+static int16_t q15_qtab[(1 << Q15_LUT_BITS) + 1];  // sin over a quarter, one guard point
+
+// Filled once at startup; on a soft-float part this is the only libm call
+void q15_sine_init(void)
+{
+    const int q = 1 << Q15_LUT_BITS;
+    for (int i = 0; i <= q; i++)
+        q15_qtab[i] = (int16_t)lrint(32767.0 * sin((double)i * (PI / 2.0) / q));
+}
+
+// Q15 sine of a 32-bit phase: quadrant folding plus linear interpolation
+static inline int32_t q15_sin(uint32_t ph)
+{
+    const uint32_t quad = ph >> 30;
+    uint32_t x = ph & 0x3FFFFFFFu;
+    if (quad & 1u) x = 0x40000000u - x;  // Mirror the falling quarters
+    const uint32_t idx = x >> (30 - Q15_LUT_BITS);
+    const int32_t frac = (int32_t)((x >> (15 - Q15_LUT_BITS)) & 0x7FFF);
+    int32_t y = q15_qtab[idx];
+    if (idx < (1u << Q15_LUT_BITS)) y += ((q15_qtab[idx + 1] - y) * frac) >> 15;
+    return (quad & 2u) ? -y : y;
+}
+
+// Rounded Q15 product
+static inline int32_t q15_mul(int32_t a, int32_t b)
+{
+    return (a * b + 16384) >> 15;
+}
+
+static inline int16_t q15_sat(int64_t v)
+{
+    return (int16_t)(v > 32767 ? 32767 : (v < -32767 ? -32767 : v));
+}
+
+/* Gains (amp, Ac, m) are Q15 with 1.0 = 32768 and may exceed 1.0; signals
+   (table entries, rendered samples) use 1.0 = 32767, the s16 sink's scale,
+   so a product of the two shifted down by 15 is already an output sample */
+static int32_t q15_level(float v, float fullscale)
+{
+    float q = v / fullscale * 32768.0f;
+    if (q > 65535.0f) q = 65535.0f;   // Products below must fit in 32 bits
+    if (q < -65535.0f) q = -65535.0f;
+    return (int32_t)lrintf(q);
+}
+
+// Takes the phases and settings of a float generator; returns 0 for the
+// modes the integer path does not cover
+int wave_gen_q15_init(wave_gen_q15 *q, const wave_gen *g, float fullscale)
+{
+    if (g->mod_type == MOD_FM || g->mod_type == MOD_PM || g->shape.bandlimited ||
+        g->waveform_type == WAVE_AWG) return 0;
+    if (fullscale <= 0.0f) fullscale = 1.0f;
+
+    q->waveform_type = g->silent ? 0 : g->waveform_type;
+    q->mod_type = g->mod_type;
+    q->osc = g->osc;
+    q->carrier = g->carrier;
+    // A modulating signal is normalized already; keep it at Q15 full scale
+    q->amp = g->mod_type ? ((g->shape.amp != 0.0f) ? 32768 : 0) : q15_level(g->shape.amp, fullscale);
+    q->duty24 = (uint32_t)ceil((double)g->shape.duty * 16777216.0);
+    q->Ac = g->mod_type ? q15_level(g->mod.Ac, fullscale) : 0;
+    q->m = g->mod_type == MOD_AM ? (int32_t)lrintf(g->mod.index * 32768.0f) : 0;
+    if (q->m > 32768 * 4) q->m = 32768 * 4;
+    if (q->m < -32768 * 4) q->m = -32768 * 4;
+    return 1;
+}
+
+void wave_gen_q15_render(wave_gen_q15 *q, int16_t *out, size_t n)
+{
+    STAT_BEGIN();
+    uint32_t ph = q->osc.phase;
+    const uint32_t inc = q->osc.inc;
+    const int32_t a = q->amp;
+    const int32_t peak = q15_mul(a, 32767);  // Gain as a signal level
+
+    switch (q->waveform_type) {
+        case 1:
+            for (size_t i = 0; i < n; i++, ph += inc) out[i] = q15_sat(q15_mul(q15_sin(ph), a));
+            break;
+        case 2:
+            for (size_t i = 0; i < n; i++, ph += inc) out[i] = q15_sat((ph >> 8) < q->duty24 ? peak : -peak);
+            break;
+        case 3:
+            for (size_t i = 0; i < n; i++, ph += inc) {
+                int32_t t = (int32_t)(ph >> 16);  // Position in the cycle, Q16
+                int32_t y = (t < 32768) ? 2 * t - 32768 : 98304 - 2 * t;  // 1.0 = 32768
+                out[i] = q15_sat(q15_mul(y, peak));
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < n; i++, ph += inc) out[i] = q15_sat(q15_mul((int32_t)(ph >> 16) - 32768, peak));
+            break;
+        default:
+            for (size_t i = 0; i < n; i++) out[i] = 0;
+            break;
+    }
+    q->osc.phase = ph;
+
+    uint32_t cph = q->carrier.phase;
+    const uint32_t cinc = q->carrier.inc;
+    if (q->mod_type == MOD_AM) {
+        for (size_t i = 0; i < n; i++, cph += cinc) {
+            // Ac * carrier * (1 + m * x): gain * signal * Q30. At the clamps
+            // |Ac * sin| < 2^31 and |env| < 2^33, so two bits come off the
+            // carrier term first to keep the product inside int64
+            int64_t env = ((int64_t)1 << 30) + (int64_t)q->m * out[i];
+            int64_t c = ((int64_t)q->Ac * q15_sin(cph) + 2) >> 2;
+            out[i] = q15_sat((c * env + ((int64_t)1 << 42)) >> 43);
+        }
+    } else if (q->mod_type == MOD_PWM) {
+        for (size_t i = 0; i < n; i++, cph += cinc) {
+            int32_t ramp = (int32_t)(cph >> 16) - 32768;            // Rising -1..1
+            int32_t level = q15_mul(q->Ac, 32767);
+            out[i] = q15_sat(out[i] > ramp ? level : -level);
+        }
+    }
+    q->carrier.phase = cph;
+    STAT_END(STAT_RENDER, n);
+}
+
+#endif
@@ -0,0 +1,513 @@
+/*
+   wavegen.h
+   Waveform Generator core (libwavegen)
+
+   Oscillators, modulators, band-limited edges, AWG tables, oscillator
+   banks, sweeps, oversampling, precise PWM, spectrum analysis, the
+   parallel renderer, the real-time stream engine and the Q15 path.
+   The core does no I/O: files, sinks and reports live in wavegen_io.h,
+   menus and command lines in the front-ends.
+
+   Every call that needs working memory takes a wavegen_ctx, whose arena
+   the caller backs with its own buffer. The only file-scope state is set
+   up once by wavegen_init() and read-only afterwards (sine table, kernel
+   set), plus the WAVEGEN_STATS counters, which are atomics.
+
+   Build flags below must be the same for the library and whatever links
+   it; the Makefile passes them to every target.
+*/
+
+#ifndef WAVEGEN_H
+#define WAVEGEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* --- Constants --- */
+#define PI 3.14159265358979323846f
+
+/* Sine lookup table used by every oscillator (build-time selectable) */
+#ifndef SINE_LUT_BITS
+#define SINE_LUT_BITS 12      // log2 of entries per full cycle (10 = 1024, 12 = 4096)
+#endif
+#ifndef SINE_LUT_INTERP
+#define SINE_LUT_INTERP 2     // 0 = libm sinf, 1 = nearest entry, 2 = linear interpolation
+#endif
+#define SINE_LUT_QUARTER (1 << (SINE_LUT_BITS - 2))  // Only a quarter wave is stored
+
+/* Integer-only Q15 generation for parts without an FPU (build-time selectable) */
+#ifndef WAVEGEN_FIXED_POINT
+#define WAVEGEN_FIXED_POINT 0  // 1 = build the Q15 path; s16 batch output then uses it
+#endif
+#define Q15_LUT_BITS 10        // log2 of Q15 quarter-wave entries
+
+/* Scratch memory: every working buffer comes from one arena over memory
+   the program provides, so it runs without a heap and its footprint is
+   fixed at build time. This is the size the front-ends reserve */
+#ifndef WAVEGEN_ARENA_BYTES
+#define WAVEGEN_ARENA_BYTES ((size_t)64 << 20)  // Host default; embedded builds shrink it
+#endif
+#define ARENA_ALIGN 64         // Every allocation starts on a cache line (SIMD loads)
+
+/* Counters and timers in the render, modulation, plot and sink paths */
+#ifndef WAVEGEN_STATS
+#define WAVEGEN_STATS 0        // 1 = build them in; 0 = every STAT_* macro is empty
+#endif
+
+// Scratch arena: a bump allocator reset per render or job. Allocations are
+// ARENA_ALIGN-aligned and never freed one by one; arena_release() rewinds
+// to an earlier arena_mark(), arena_reset() to empty
+typedef struct arena {
+    unsigned char *base;
+    size_t cap;
+    size_t used;
+    size_t high;       // High-water mark of used
+    unsigned failed;   // Requests that did not fit
+    void (*on_fail)(const struct arena *a, size_t bytes);  // Told about each, NULL = quiet
+} arena;
+
+void *arena_alloc(arena *a, size_t bytes);
+size_t arena_mark(const arena *a);
+void arena_release(arena *a, size_t mark);
+void arena_reset(arena *a);
+
+/* Library context: the arena every allocating call draws from and the
+   version a wave_cache is checked against. One per thread; a renderer
+   never touches another thread's context */
+typedef struct {
+    arena scratch;
+    unsigned cache_version;  // Bump on any change a cached period must not survive
+} wavegen_ctx;
+
+void wavegen_init(void);
+void wavegen_ctx_init(wavegen_ctx *ctx, void *mem, size_t bytes);
+
+// Single-pass parsing without copies or allocation, for command lines
+char *next_token(char **cursor);
+const char *parse_decimal(const char *s, const char *end, double *out);
+int parse_number_span(const char *s, const char *end, double *out);
+int parse_phase_span(const char *s, const char *end, float *out_rad);
+int parse_phase_input_to_rad(const char *s_in, float *out_rad);
+
+size_t render_ascii_frame(const float *yvals, int cols, int rows, float amp,
+                          char *frame, size_t cap);
+
+/* Snapshot of one base waveform's settings, taken once per block */
+typedef struct {
+    float freq;   // Hz
+    float amp;    // V (jump amplitude for sawtooth)
+    float phase;  // rad, only used by sine
+    float duty;   // 0..1, only used by square
+    int bandlimited;  // 1 = PolyBLEP/BLAMP edges for square, triangle, sawtooth
+    const struct awg_table *table;  // Loaded period, only used by the AWG
+} wave_params;
+
+/* One generator's editable settings: a wave_params per base waveform */
+typedef struct {
+    wave_params wave[6];  // Indexed by waveform type 1..5; phase only used by
+                          // sine, duty only by square
+    float slope;          // Sawtooth slope (shown, shape unaffected)
+    int bandlimited;      // Quality mode (--quality), copied into every snapshot
+    char awg_path[256];   // Last table file the AWG menu loaded
+    int awg_interp;       // AWG_* interpolation picked in the menu
+    int awg_mipmap;       // 1 = play the AWG through its mipmaps
+} wave_settings;
+
+void wave_settings_init(wave_settings *s);
+void wave_settings_get(const wave_settings *s, int waveform_type, wave_params *p);
+
+/* Phase-accumulator (DDS) oscillator: one full cycle is 2^32 phase units,
+   so the phase wraps for free and never loses precision over long runs */
+typedef struct {
+    uint32_t phase;  // Current position in the cycle
+    uint32_t inc;    // Phase step per sample, from freq * dt
+} dds_osc;
+
+#define DDS_TURN 4294967296.0  // Phase units per cycle (2^32)
+
+uint32_t dds_phase_from_cycles(double cycles);
+void dds_init(dds_osc *o, double freq, double dt, double start_cycles);
+void render_dds_block(int waveform_type, const wave_params *p, dds_osc *o,
+                      float *out, size_t n);
+
+// Max and RMS error over probes phases: of sinf() against sin(), and of
+// each table size against sinf() (nearest entry and linear interpolation)
+typedef struct { double near_max, near_rms, lin_max, lin_rms; } sine_lut_error;
+
+void sine_lut_init(void);
+void sine_lut_reference_error(int probes, double *max, double *rms);
+int sine_lut_measure(wavegen_ctx *ctx, int bits, int probes, sine_lut_error *e);
+void kernels_init(void);
+const char *kernels_name(void);
+int kernels_self_check(wavegen_ctx *ctx, void (*report)(const char *name, int ok));
+
+void render_waveform_block(int waveform_type, const wave_params *p,
+                           float t0, float dt, float *out, size_t n);
+float sample_base_waveform(int waveform_type, const wave_params *p, float t);
+
+/* Modulation engine: renders the normalized modulating signal once per
+   block and lets each modulator apply only its own per-sample math */
+enum { MOD_AM = 1, MOD_FM = 2, MOD_PWM = 3, MOD_PM = 4 };
+
+typedef struct {
+    float Ac;     // Carrier amplitude (PWM: output level)
+    float fc;     // Carrier frequency in Hz (PWM: ramp frequency)
+    float index;  // m for AM, beta for FM and PM, unused by PWM
+    float t0;     // Time of out[0] in seconds
+    float dt;     // Sample spacing in seconds
+} mod_params;
+
+void modulate_block(int mod_type, int waveform_type, const wave_params *base,
+                    const mod_params *mod, float *out, size_t n);
+
+/* Streaming generator: base oscillator plus optional modulation, keeping its
+   phases between calls so consecutive blocks join up sample-exactly */
+typedef struct {
+    int waveform_type;
+    int mod_type;        // 0 = none, else MOD_*
+    int silent;          // Renders zeros (no positive frequency, unknown type)
+    wave_params shape;   // Base settings (amplitude normalized when modulating)
+    mod_params mod;
+    dds_osc osc;         // Base / modulating oscillator
+    dds_osc carrier;     // Modulation carrier
+    float fm_dev;        // FM: peak change of the carrier's phase step, in phase units
+    double dt;           // Sample spacing, kept for retuning at run time
+    uint32_t ramp_left;  // Samples left in a live-update ramp
+    float amp_step;      // Per-sample amplitude change while ramping
+    float amp_target;
+    int64_t inc_fx;      // Phase step in 32.16 fixed point while ramping
+    int64_t inc_step;
+    uint32_t inc_target;
+    float fm_dev_step;   // Per-sample FM deviation change while ramping
+    float fm_dev_target;
+} wave_gen;
+
+/* Live parameter change for a running generator. Applied at a block
+   boundary; amplitude, frequency and the FM deviation that scales with it
+   glide linearly over ramp samples */
+typedef struct {
+    wave_params shape;    // freq, amp, phase (sine), duty (square)
+    float Ac, fc, index;  // Modulation settings, ignored without modulation
+    uint32_t ramp;        // 0 = step change
+} wave_update;
+
+void wave_gen_init(wave_gen *g, int waveform_type, const wave_params *base,
+                   int mod_type, const mod_params *mod, double t0, double dt);
+void wave_gen_render(wave_gen *g, float *out, size_t n);
+void wave_gen_advance(wave_gen *g, uint64_t n);
+void wave_gen_update(wave_gen *g, const wave_update *u);
+
+/* Oscillator bank: N independent unmodulated channels for multi-channel
+   rigs. Parameters and phases are kept as structure of arrays, so retuning
+   and advancing walk contiguous memory and the per-block phase update is a
+   single vectorizable loop across all channels. Each channel renders with
+   the same kernels as wave_gen, so channel c matches a mono run exactly */
+#define BANK_MAX_CHANNELS 256
+#define BANK_TILE 1024  // Frames per channel between phase updates
+enum { BANK_INTERLEAVED = 0, BANK_PLANAR = 1 };
+
+typedef struct {
+    size_t channels;
+    double dt;
+    int bandlimited;
+    int *waveform;     // Waveform type per channel, 0 = silent
+    float *freq;       // Hz
+    float *amp;        // V
+    float *phase;      // rad, sine only
+    float *duty;       // 0..1, square only
+    uint32_t *ph;      // DDS phase per channel
+    uint32_t *inc;     // DDS step per channel
+    float *tile;       // One channel's tile, for interleaving
+} osc_bank;
+
+int osc_bank_init(wavegen_ctx *ctx, osc_bank *b, size_t channels, double rate, int bandlimited);
+void osc_bank_set(osc_bank *b, size_t ch, int waveform_type, const wave_params *p);
+void osc_bank_render(osc_bank *b, float *out, size_t frames, int layout);
+
+/* Frequency sweep (chirp) on the DDS core: the phase step follows the
+   sweep law sample by sample with one add (linear) or one multiply
+   (exponential), never a pow/exp per sample */
+#define SWEEP_TILE 256  // Phases computed ahead of each shaping pass
+enum { SWEEP_LINEAR = 1, SWEEP_EXP = 2 };
+
+typedef struct {
+    int law;          // SWEEP_*, 0 = no sweep
+    float f0, f1;     // Start and stop frequency in Hz
+    double duration;  // Seconds from f0 to f1; f1 holds afterwards
+} sweep_params;
+
+typedef struct {
+    int waveform_type;
+    wave_params shape;   // amp, duty; freq is unused
+    int law;
+    uint32_t phase;
+    double inc;          // Phase step of the next sample, in phase units
+    double step;         // Added (linear) or multiplied in (exponential) per sample
+    double inc_end;      // Step at f1, taken exactly once the sweep is over
+    uint64_t left;       // Samples until f1
+} wave_sweep;
+
+int wave_sweep_init(wave_sweep *w, int waveform_type, const wave_params *base,
+                    const sweep_params *sp, double rate);
+void wave_sweep_render(wave_sweep *w, float *out, size_t n);
+
+/* Arbitrary waveform (AWG): one period played by the DDS phase, whose top
+   bits pick the table entry and whose low bits interpolate. Optional
+   mipmaps keep per-octave copies low-passed below their own Nyquist;
+   playback takes the longest level stepping at most one entry per sample,
+   so a detailed table does not alias at high pitch. awg_build() takes the
+   period from memory; awg_load() (wavegen_io.h) reads it from a file */
+#define WAVE_AWG 5
+#define AWG_MAX_LEN (1u << 24)   // Entries; keeps phase * len inside 64 bits
+#define AWG_MAX_LEVELS 24
+#define AWG_MIN_LEVEL_LEN 4      // Mipmaps stop halving at this length
+#define AWG_HALFBAND_TAPS 15     // One-sided taps of the mipmap decimator (odd)
+enum { AWG_NEAREST = 1, AWG_LINEAR = 2, AWG_CUBIC = 3 };
+
+typedef struct awg_table {
+    int interp;                         // AWG_*
+    int levels;                         // 1 = no mipmaps
+    float gain;                         // 1 / peak, so the amplitude is the output peak
+    size_t len[AWG_MAX_LEVELS];         // Level k holds len[0] >> k entries
+    const float *data[AWG_MAX_LEVELS];
+    void *map;                          // Raw float32 plays from the file mapping
+    size_t map_len;
+} awg_table;
+
+int awg_build(wavegen_ctx *ctx, awg_table *t, const float *data, size_t len,
+              int interp, int mipmap);
+void awg_render(const awg_table *t, uint32_t phase, uint32_t inc, float a,
+                float *out, size_t n);
+
+/* Oversampling: render at ratio times the output rate and decimate through
+   a cascade of halfband FIR stages, one per factor of two. Every second
+   halfband tap is zero, so each stage filters the even and odd input
+   phases separately (polyphase) and costs taps + 1 multiplies per output.
+   Stages far above the output band get short filters */
+#define OVERSAMPLE_MAX 64
+#define OVERSAMPLE_MAX_STAGES 6    // log2(OVERSAMPLE_MAX)
+#define OVERSAMPLE_PASSBAND 0.45   // Flat up to this fraction of the output rate
+#define HALFBAND_MAX_TAPS 64       // Nonzero one-sided taps per stage
+
+typedef struct {
+    size_t taps;                   // Nonzero taps each side of the centre
+    float c[HALFBAND_MAX_TAPS];
+    float *e, *o;                  // Even / odd inputs behind 2 * taps - 1 / taps of history
+} halfband_stage;
+
+typedef struct {
+    int ratio;                     // 1 = pass through
+    int stages;
+    size_t max_in;                 // Input samples per call at most
+    size_t delay;                  // Group delay in input samples
+    halfband_stage st[OVERSAMPLE_MAX_STAGES];
+} decimator;
+
+int decimator_init(wavegen_ctx *ctx, decimator *d, int ratio, double stopband_db, size_t max_in);
+void decimator_run(decimator *d, float *x, size_t n, float *out);
+
+/* Precise PWM: the comparator's edges are solved once per carrier period
+   instead of found by comparing every sample. The result is either a
+   sampled waveform with each edge at its exact, fractional time, or one
+   compare value per period for a timer peripheral fed by DMA */
+#define PWM_MAX_CARRY 4  // Edges in the last sample of a block (2 with period >= 2)
+
+typedef struct {
+    size_t j;            // Sample at or before the edge
+    float d;             // Edge time minus j, 0..1
+    float h;             // +Ac rising, -Ac falling
+} pwm_edge;
+
+typedef struct {
+    int waveform_type;
+    int silent;
+    wave_params shape;   // Modulating signal at amplitude 1
+    dds_osc mod;         // Its phase; one step per carrier period
+    float Ac;
+    double period;       // Carrier period in samples (or timer ticks)
+    uint64_t k;          // Current period
+    double duty;         // High fraction of period k
+    float x_next;        // Modulating value at the end of period k
+    uint64_t origin;     // Samples rendered so far
+    int bandlimited;     // 1 = PolyBLEP residuals at every edge
+    pwm_edge *edges;     // Per-block scratch for the residual pass
+    size_t edge_cap;
+    pwm_edge carry[PWM_MAX_CARRY];  // Edges whose second residual lands in the next block
+    int carried;
+} pwm_engine;
+
+int pwm_engine_init(pwm_engine *e, int waveform_type, const wave_params *base, float Ac,
+                    double fc, double rate, pwm_edge *edges, size_t edge_cap);
+double pwm_engine_next_duty(pwm_engine *e);
+void pwm_engine_render(pwm_engine *e, float *out, size_t n);
+
+/* Spectrum analysis: a 7-term Blackman-Harris windowed real FFT of rendered
+   samples, reduced to the usual converter figures. The fundamental is the
+   strongest bin; harmonics are looked for at its multiples below Nyquist */
+#define ANALYZE_MIN_FFT 64
+#define ANALYZE_MAX_FFT (1u << 20)     // Longer renders are analyzed from the start
+#define ANALYZE_HARMONICS 10           // Highest harmonic measured
+#define ANALYZE_LOBE 8                 // Bins each side of a tone counted as the tone
+
+typedef struct {
+    size_t n;                          // Real points, a power of two
+    float *tw_re, *tw_im;              // Radix-2 pass with half-size h at [h - 1, 2h - 1)
+    float *rt_re, *rt_im;              // exp(-2 pi i k / n), k < n / 2
+} fft_plan;
+
+typedef struct {
+    size_t n;                          // FFT points used
+    double rate;
+    double f0, amp;                    // Fundamental: Hz and peak V
+    double dc;                         // Mean of the analyzed samples, V
+    double harm_dbc[ANALYZE_HARMONICS + 1];  // [h], 2 <= h; below -999 = above Nyquist
+    double thd_pct, thd_db, snr_db, sinad_db, sfdr_db, enob;
+} spectrum_report;
+
+int fft_plan_init(wavegen_ctx *ctx, fft_plan *p, size_t n);
+void fft_real(const fft_plan *p, float *re, float *im);
+int spectrum_analyze(wavegen_ctx *ctx, const float *x, size_t n, double rate,
+                     spectrum_report *r, float *db);
+
+/* Per-period cache: one rendered period, repeated to a tile of whole
+   periods and reused until the parameters change. Long periodic outputs
+   are then written tile by tile instead of being re-rendered */
+#define WAVE_CACHE_MIN_TILE 65536         // Periods repeat until the tile is this long
+#define WAVE_CACHE_MAX_PERIOD (1u << 20)  // Longer periods are not cached
+
+typedef struct {
+    int valid;
+    unsigned version;    // The context's cache_version at fill time
+    int waveform_type;
+    wave_params p;
+    double dt;
+    size_t period;       // Samples per period
+    size_t len;          // Samples in buf, a whole number of periods
+    size_t cap;          // Samples buf holds; the owner provides the storage
+    float *buf;
+} wave_cache;
+
+size_t wave_cache_exact_period(const wave_params *p, double rate);
+const float *wave_cache_get(const wavegen_ctx *ctx, wave_cache *c, int waveform_type,
+                            const wave_params *p, double dt, size_t period, size_t min_len);
+void wave_cache_init(wave_cache *c, float *buf, size_t cap);
+
+/* Parallel renderer: a pthread pool splits one output buffer into
+   cache-sized chunks; each chunk seeks its own copy of the generator to
+   its first sample, so the result is bit-identical to a serial render */
+#define POOL_MAX_THREADS 256
+#define POOL_CHUNK 16384  // Samples per work item (64 KB of float)
+#define PARALLEL_BLOCK (1u << 22)  // Samples per pass when rendering with --threads
+
+typedef struct {
+    pthread_t threads[POOL_MAX_THREADS];
+    int nthreads;               // Worker threads (the caller helps as well)
+    uint32_t *fm_base;          // FM: per-chunk phase sums, then carrier start phases
+    size_t fm_cap;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned generation;        // Bumped for every new job
+    int shutdown;
+    // Current job
+    const wave_gen *origin;     // Generator state at out[0]
+    int pass;                   // POOL_* work done per chunk
+    float *out;
+    size_t n;
+    size_t next_chunk, chunks, pending;
+} render_pool;
+
+int render_pool_start(wavegen_ctx *ctx, render_pool *p, int nthreads);
+void render_pool_render(render_pool *p, wave_gen *g, float *out, size_t n);
+void render_pool_stop(render_pool *p);
+int default_thread_count(void);
+
+/* Real-time streaming: a producer thread renders fixed-size blocks into a
+   lock-free single-producer/single-consumer ring; the consumer (audio
+   callback, DMA ISR, file writer) drains it without locks or allocation */
+#define STREAM_BLOCK 256        // Samples per produced block
+#define STREAM_RING_BLOCKS 64   // Ring capacity in blocks (power of two)
+
+typedef struct {
+    float *buf;
+    size_t capacity;             // Samples, power of two, multiple of STREAM_BLOCK
+    _Atomic size_t head;         // Total samples written (producer only)
+    _Atomic size_t tail;         // Total samples read (consumer only)
+    _Atomic uint64_t underruns;  // Reads that found fewer samples than asked for
+    _Atomic uint64_t overruns;   // Times the producer ran into a full ring
+} spsc_ring;
+
+/* Triple-buffered parameter mailbox: one control thread publishes, the
+   producer picks up the newest update between blocks; neither side waits */
+#define MAILBOX_FRESH 4u  // Set in middle when it holds an unread update
+
+typedef struct {
+    wave_update slot[3];
+    _Atomic unsigned middle;  // Slot index last published, plus MAILBOX_FRESH
+    unsigned back;            // Writer's slot
+    unsigned front;           // Reader's slot
+} param_mailbox;
+
+typedef struct {
+    spsc_ring ring;
+    param_mailbox params;
+    wave_gen gen;
+    uint64_t total;              // Samples to produce, 0 = until stopped
+    _Atomic int running;
+    pthread_t producer;
+} stream_engine;
+
+int stream_start(wavegen_ctx *ctx, stream_engine *e, const wave_gen *g, uint64_t total);
+size_t stream_read(stream_engine *e, float *dst, size_t n);
+void stream_stop(stream_engine *e);
+void stream_update(stream_engine *e, const wave_update *u);
+void sleep_ns(long ns);
+
+#if WAVEGEN_FIXED_POINT
+/* Fixed-point generator: the same 32-bit phase accumulators as wave_gen
+   (an unsigned Q32 turn, i.e. Q31 with the sign bit put to use), a Q15
+   sine table and Q15 amplitude, AM and PWM math. Floats are only touched
+   when the generator is set up, never per sample */
+typedef struct {
+    int waveform_type;
+    int mod_type;        // 0, MOD_AM or MOD_PWM
+    dds_osc osc;
+    dds_osc carrier;
+    int32_t amp;         // Q15 gain, 32768 = sink full scale
+    uint32_t duty24;     // Square: high while the top 24 phase bits are below this
+    int32_t Ac;          // Q15 carrier gain (PWM: output level)
+    int32_t m;           // Q15 AM index, may exceed 1.0
+} wave_gen_q15;
+
+void q15_sine_init(void);
+int wave_gen_q15_init(wave_gen_q15 *q, const wave_gen *g, float fullscale);
+void wave_gen_q15_render(wave_gen_q15 *q, int16_t *out, size_t n);
+#endif
+
+// Instrumentation. STAT_BEGIN() starts the one timer of a scope and
+// STAT_END(slot, samples) books it; STAT_COUNT(slot) bumps an event counter.
+#if WAVEGEN_STATS
+enum {
+    STAT_RENDER, STAT_MOD_AM, STAT_MOD_FM, STAT_MOD_PWM, STAT_MOD_PM,
+    STAT_ASCII, STAT_SINK, STAT_UNDERRUN, STAT_OVERRUN, STAT_SLOTS
+};
+typedef struct { uint64_t ns, cycles; } stat_mark;
+typedef struct { uint64_t calls, samples, ns, cycles; } stat_totals;
+void stats_init(void);
+stat_mark stat_begin(void);
+void stat_end(int slot, const stat_mark *m, size_t samples);
+void stat_count(int slot);
+void stats_read(int slot, stat_totals *t);
+const char *stat_name(int slot);
+#define STAT_BEGIN() stat_mark stat_mark_ = stat_begin()
+#define STAT_END(slot, samples) stat_end((slot), &stat_mark_, (samples))
+#define STAT_COUNT(slot) stat_count(slot)
+#else
+#define STAT_BEGIN() ((void)0)
+#define STAT_END(slot, samples) ((void)0)
+#define STAT_COUNT(slot) ((void)0)
+#endif
+
+#endif /* WAVEGEN_H */
@@ -0,0 +1,195 @@
+/*
+   wavegen_bench.c
+   Waveform Generator: render benchmark
+
+   usage: wavegen-bench [--bench-max N] [--bench-reps R] [--cpu-ghz G]
+
+   Built on its own so it can be tuned apart from the other front-ends,
+   e.g. make wavegen-bench BENCH_CFLAGS='-O3 -march=native' LTO=1.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "wavegen_io.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WAVEGEN_X86 1
+#include <x86intrin.h>
+#endif
+
+#define BENCH_MAX_SAMPLES 100000000  // Largest --bench-max
+
+// The bench buffer alone is BENCH_MAX_SAMPLES floats, more than the
+// library's WAVEGEN_ARENA_BYTES default, so this binary sizes its own arena
+// (untouched pages of it cost no memory)
+#define BENCH_ARENA_BYTES ((size_t)BENCH_MAX_SAMPLES * sizeof(float) + ((size_t)1 << 20))
+
+static _Alignas(ARENA_ALIGN) unsigned char scratch_mem[BENCH_ARENA_BYTES];
+
+/* ---------- Benchmark Harness ---------- */
+
+/*
+   wavegen-bench times the per-sample API, the block renderer and each modulator
+   over buffer sizes from 1K up to --bench-max (default 10M, up to 100M).
+   Every case gets one warmup run and --bench-reps timed runs (default 11);
+   small sizes repeat inside a run until it lasts at least BENCH_MIN_SEC.
+   Reported: median Msamples/s, median and p99 ns/sample, and cycles/sample
+   from the TSC on x86 (or from --cpu-ghz elsewhere).
+*/
+
+#define BENCH_MIN_SEC 0.002
+#define BENCH_MAX_REPS 101
+
+typedef struct {
+    const char *name;
+    int waveform_type;
+    int mod_type;      // 0 = plain block render
+    int per_sample;    // 1 = go through sample_base_waveform()
+    int bandlimited;   // 1 = --quality blep
+} bench_case;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t bench_cycles(void)
+{
+#if WAVEGEN_X86
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// One timed run of a case over n samples
+static void bench_run(const bench_case *bc, float *buf, size_t n)
+{
+    const double dt = 1.0 / 48000.0;
+    if (bc->per_sample) {
+        // The menus' defaults, as the per-sample API is used from a UI
+        wave_settings s;
+        wave_params p;
+        wave_settings_init(&s);
+        wave_settings_get(&s, bc->waveform_type, &p);
+        for (size_t i = 0; i < n; i++) buf[i] = sample_base_waveform(bc->waveform_type, &p, (float)(i * dt));
+        return;
+    }
+
+    wave_params wp = { 1000.0f, 1.0f, 0.0f, 0.5f, bc->bandlimited, NULL };
+    mod_params mp = { 1.0f, 10000.0f, 0.5f, 0.0f, 0.0f };
+    wave_gen g;
+    wave_gen_init(&g, bc->waveform_type, &wp, bc->mod_type, &mp, 0.0, dt);
+    wave_gen_render(&g, buf, n);
+}
+
+static int run_bench(wavegen_ctx *ctx, int argc, char const *argv[])
+{
+    static const bench_case cases[] = {
+        { "sample_base_waveform sine", 1, 0, 1, 0 },
+        { "sample_base_waveform square", 2, 0, 1, 0 },
+        { "block sine", 1, 0, 0, 0 },
+        { "block square", 2, 0, 0, 0 },
+        { "block triangle", 3, 0, 0, 0 },
+        { "block sawtooth", 4, 0, 0, 0 },
+        { "block square blep", 2, 0, 0, 1 },
+        { "block triangle blep", 3, 0, 0, 1 },
+        { "block sawtooth blep", 4, 0, 0, 1 },
+        { "AM (sine x sine)", 1, MOD_AM, 0, 0 },
+        { "FM (sine x sine)", 1, MOD_FM, 0, 0 },
+        { "PM (sine x sine)", 1, MOD_PM, 0, 0 },
+        { "PWM (sine)", 1, MOD_PWM, 0, 0 },
+    };
+    double max_size = 1e7, cpu_ghz = 0.0, v;
+    int reps = 11;
+
+    // A leading --bench is accepted for scripts that still pass it
+    int i = (argc > 1 && strcmp(argv[1], "--bench") == 0) ? 2 : 1;
+    for (; i < argc; i += 2) {
+        const char *val = (i + 1 < argc) ? argv[i + 1] : "";
+        const char *end = val + strlen(val);
+        if (strcmp(argv[i], "--bench-max") == 0 && parse_number_span(val, end, &v) && v >= 1e3) max_size = v;
+        else if (strcmp(argv[i], "--bench-reps") == 0 && parse_number_span(val, end, &v) && v >= 1)
+            reps = (v < BENCH_MAX_REPS) ? (int)v : BENCH_MAX_REPS;  // Clamped before the cast
+        else if (strcmp(argv[i], "--cpu-ghz") == 0 && parse_number_span(val, end, &v) && v > 0) cpu_ghz = v;
+        else {
+            if (strcmp(argv[i], "--help") != 0 && strcmp(argv[i], "-h") != 0)
+                fprintf(stderr, "%s: bad bench option %s\n", argv[0], argv[i]);
+            fprintf(stderr, "usage: %s [--bench-max N] [--bench-reps R] [--cpu-ghz G]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (max_size > BENCH_MAX_SAMPLES) max_size = BENCH_MAX_SAMPLES;
+
+    float *buf = (float *)arena_alloc(&ctx->scratch, (size_t)max_size * sizeof(float));
+    if (!buf) { fprintf(stderr, "bench: cannot allocate %.0f samples\n", max_size); return 1; }
+
+    printf("kernels: %s, SINE_LUT_BITS %d, SINE_LUT_INTERP %d, %d reps\n",
+           kernels_name(), SINE_LUT_BITS, SINE_LUT_INTERP, reps);
+    printf("%-28s %10s %12s %12s %12s %12s\n",
+           "case", "samples", "Msamples/s", "ns/smp med", "ns/smp p99", "cyc/smp");
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (double size = 1e3; size <= max_size + 0.5; size *= 10.0) {
+            const size_t n = (size_t)size;
+            double ns[BENCH_MAX_REPS], cyc[BENCH_MAX_REPS];
+
+            // Warmup, and find how many runs make one measurable rep
+            double t0 = bench_now();
+            bench_run(&cases[c], buf, n);
+            double once = bench_now() - t0;
+            int inner = (once > 0.0 && once < BENCH_MIN_SEC) ? (int)(BENCH_MIN_SEC / once) + 1 : 1;
+
+            for (int r = 0; r < reps; r++) {
+                uint64_t c0 = bench_cycles();
+                double start = bench_now();
+                for (int k = 0; k < inner; k++) bench_run(&cases[c], buf, n);
+                double elapsed = bench_now() - start;
+                uint64_t c1 = bench_cycles();
+                double total = (double)n * inner;
+                ns[r] = elapsed * 1e9 / total;
+                cyc[r] = (c1 > c0) ? (double)(c1 - c0) / total : ns[r] * cpu_ghz;
+            }
+
+            qsort(ns, (size_t)reps, sizeof(double), cmp_double);
+            qsort(cyc, (size_t)reps, sizeof(double), cmp_double);
+            double med = ns[reps / 2];
+            double p99 = ns[(int)ceil(0.99 * reps) - 1];
+            double cyc_med = cyc[reps / 2];
+
+            char cyc_str[32];
+            if (cyc_med > 0.0) snprintf(cyc_str, sizeof(cyc_str), "%.2f", cyc_med);
+            else snprintf(cyc_str, sizeof(cyc_str), "n/a");
+            printf("%-28s %10zu %12.1f %12.3f %12.3f %12s\n",
+                   cases[c].name, n, 1e3 / med, med, p99, cyc_str);
+        }
+    }
+
+    arena_reset(&ctx->scratch);
+    return 0;
+}
+
+
+int main(int argc, char const *argv[]) {
+    wavegen_ctx ctx;
+
+    wavegen_init();
+    wavegen_ctx_init(&ctx, scratch_mem, sizeof(scratch_mem));
+    ctx.scratch.on_fail = arena_print_failure;
+    return run_bench(&ctx, argc, argv);
+}
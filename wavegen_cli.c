@@ -0,0 +1,1801 @@
+/*
+   wavegen_cli.c
+   Waveform Generator: batch command line
+
+   Renders to files or stdout without a terminal UI: plain and threaded
+   batch output, streaming with live control, --commands scripts,
+   --jobs files, --bake headers and the self-checks. The menus are the
+   wavegen binary, the timing harness wavegen-bench.
+
+   Build (see the Makefile): make wavegen-cli
+   Add DEFS=-DWAVEGEN_BAKED='"table.h"' to play a table written by --bake.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // clock_gettime, pthreads, sigaction, mmap, strtok_r
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wavegen_io.h"
+
+/* Baked period: -DWAVEGEN_BAKED='"table.h"' compiles in a header written by
+   --bake, so a fixed configuration plays from a const (flash) table */
+#ifdef WAVEGEN_BAKED
+#include WAVEGEN_BAKED
+#define WAVE_BAKED 6           // --wave baked
+#endif
+
+int run_cli(wavegen_ctx *ctx, int argc, char const *argv[]);
+
+static _Alignas(ARENA_ALIGN) unsigned char scratch_mem[WAVEGEN_ARENA_BYTES];
+
+int main(int argc, char const *argv[]) {
+    wavegen_ctx ctx;
+
+    // Standard startup
+    wavegen_init();
+#if WAVEGEN_STATS
+    stats_watch_signal();
+#endif
+    wavegen_ctx_init(&ctx, scratch_mem, sizeof(scratch_mem));
+    ctx.scratch.on_fail = arena_print_failure;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s [options], %s --help for the list\n", argv[0], argv[0]);
+        return 2;
+    }
+    return run_cli(&ctx, argc, argv);
+}
+
+/* ---------- Batch Mode (command line) ---------- */
+
+/*
+   Non-interactive generation, e.g.
+     wavegen-cli --wave sine --freq 1k --amp 1 --phase 90deg \
+                --mod am:fc=10k,m=0.5 --rate 48000 --samples 10M --out file.bin
+   Nothing but errors is printed; samples go straight from the block
+   renderer into a binary sink (raw float32/int16/int24 or WAV).
+*/
+
+#define BATCH_BLOCK 65536    // Samples rendered and written per pass
+#define SAMPLES_MAX 1e15     // Largest --samples (and render N), about 650 years at 48 kHz
+#define RATE_MAX 1e9         // Largest --rate in Hz
+
+typedef struct {
+    int waveform_type;
+    wave_params base;
+    int mod_type;
+    mod_params mod;
+    double rate;         // Samples per second
+    uint64_t samples;    // Total samples to render
+    const char *out_path;
+    int format;          // FMT_*
+    int wav;             // 1 = WAV container
+    float fullscale;     // Volts at PCM full scale
+    int threads;         // Render threads, 1 = serial
+    int stream;          // STREAM_* consumer mode, 0 = plain batch
+    size_t period;       // Samples the streaming consumer takes per callback
+    int control;         // 1 = read live parameter changes from stdin
+    const char *bake_path;  // Write one period as a C header instead of samples
+    int stats;           // 1 = dump the instrumentation counters at exit
+    int channels;        // Oscillator bank channels, 1 = plain mono render
+    float chan_step;     // Hz added to --freq per channel
+    int layout;          // BANK_* sample order for multi-channel output
+    int mapped;          // 1 = mmap the output file instead of writing it
+    int mem_report;      // 1 = print the scratch arena high-water mark at exit
+    sweep_params sweep;  // --sweep; law 0 = fixed frequency
+    const char *awg_path;  // --table file for --wave awg
+    int awg_interp;      // AWG_*
+    int awg_mipmap;      // 1 = band-limited mipmaps
+    awg_table awg;       // Loaded by run_cli; base.table points here
+    int oversample;      // Render at this multiple of the rate and decimate, 1 = off
+    double stopband;     // Decimator alias rejection in dB
+    int pwm_out;         // PWM_OUT_*, 0 = the sample-by-sample comparator
+    double timer_clk;    // Timer counter clock in Hz for PWM_OUT_TIMER
+    const char *commands;  // --commands script, "-" = stdin
+    int analyze;         // ANALYZE_*, 0 = off
+    sample_tap *tap;     // Set by run_job while --analyze collects samples
+    int plot_cols, plot_rows;  // --plot-size of the --analyze plot
+    wavegen_ctx *ctx;    // Set by the caller after parsing: scratch memory and cache version
+    wave_cache *period_cache;  // A --jobs worker's cache, kept across its jobs; NULL = per job
+} cli_job;
+
+enum { STREAM_FAST = 1, STREAM_REALTIME = 2 };
+enum { PWM_OUT_EXACT = 1, PWM_OUT_TIMER = 2 };
+enum { ANALYZE_REPORT = 1, ANALYZE_PLOT = 2 };
+
+static void print_cli_usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --wave sine|square|triangle|sawtooth|awg\n"
+        "  --freq F        frequency in Hz (k/M suffix allowed)\n"
+        "  --amp A         amplitude in V\n"
+        "  --phase P       sine phase, e.g. 1.57  3.14/2  90deg  d:90  r:1.57\n"
+        "  --duty D        square duty cycle 0..1\n"
+        "  --slope S       sawtooth slope\n"
+        "  --table FILE    one period for --wave awg (implied): raw float32, .csv/.txt, or .wav\n"
+        "  --interp I      AWG interpolation: nearest | linear | cubic (default linear)\n"
+        "  --mipmap on|off AWG per-octave band-limited copies (default on)\n"
+        "  --quality Q     naive | blep (band-limited square/triangle/sawtooth edges)\n"
+        "  --mod TYPE:k=v,...  am:fc=,m=,Ac=  fm:fc=,beta=,Ac=  pm:fc=,beta=,Ac=  pwm:fc=,Ac=\n"
+        "  --pwm-out MODE  with --mod pwm, solve the edges once per carrier period:\n"
+        "                  exact (sampled, fractional edges; band-limited with --quality blep)\n"
+        "                  timer:clk=F (one compare value per period for a timer counting at F Hz,\n"
+        "                  u16 little-endian, u32 if a period exceeds 65535 counts)\n"
+        "  --sweep LAW:f0=,f1=,T=  lin | exp chirp from f0 to f1 Hz over T s, then hold f1\n"
+        "                  (--samples defaults to T * rate)\n"
+        "  --rate R        sample rate in Hz (default 48000)\n"
+        "  --oversample N  render at N x the rate (2, 4, ... %d) and decimate through halfband FIRs\n"
+        "  --stopband DB   decimator alias rejection, 40..160 dB (default 100)\n"
+        "  --samples N     number of samples (k/M/G suffix allowed)\n"
+        "  --out FILE      output file, '-' for stdout\n"
+        "  --format F      f32 | s16 | s24 | wav16 | wav24 | wavf32 (default f32, little-endian)\n"
+        "  --fullscale V   volts mapped to PCM full scale (default 1)\n"
+        "  --io stdio|mmap mmap sizes --out to --samples and renders into the mapping\n"
+        "  --threads N     render threads, 0 = one per CPU (default 1)\n"
+        "  --stream MODE   render through the real-time ring: fast | realtime\n"
+        "                  (realtime paces the consumer at --rate; --samples 0 runs until Ctrl-C)\n"
+        "  --period N      samples per consumer callback in --stream mode (default 1024)\n"
+        "  --control stdin live changes in --stream mode, one line each, e.g.\n"
+        "                  'freq=880 amp=0.5 ramp=4800' (keys: freq amp phase duty fc Ac m ramp)\n"
+        "  --commands FILE command lines from FILE or '-' (stdin), e.g. 'set sine.freq 1k',\n"
+        "                  'set sine.phase 90deg', 'set mod.fc 10k', 'wave square', 'render 4096'\n"
+        "  --channels N    N oscillators in one bank (max %d), written as N-channel frames\n"
+        "  --chan-step F   channel c plays --freq + c * F Hz\n"
+        "  --layout L      interleaved | planar (raw formats: each block of %d/N frames as N planes)\n"
+        "  --analyze A     report | plot: FFT of the output (first %u samples): THD, SNR, SFDR;\n"
+        "                  plot adds an ASCII spectrum; --out is then optional\n"
+        "  --jobs FILE     render one job per line of FILE (same options; the others are defaults),\n"
+        "                  deduplicated and spread over --threads workers (default one per CPU)\n"
+        "  --bake FILE.h   write one period as a C table for -DWAVEGEN_BAKED='\"FILE.h\"'\n"
+#ifdef WAVEGEN_BAKED
+        "  --wave baked    play the compiled-in table (" WAVEGEN_BAKED_DESC ")\n"
+#endif
+        "  --plot-size WxH ASCII size of the --analyze plot (max %dx%d)\n"
+        "  --mem-report stderr  print the scratch memory high-water mark at exit\n"
+#if WAVEGEN_STATS
+        "  --stats stderr  dump render/sink counters at exit (kill -USR1 dumps mid-run)\n"
+#endif
+        "  --lut-report    print the sine table error report\n"
+        "  --simd-check    verify the SIMD kernels against the scalar ones\n"
+#if WAVEGEN_FIXED_POINT
+        "  --fixed-check   compare the Q15 path with the float path\n"
+#endif
+        "interactive menus: wavegen; timing: wavegen-bench\n",
+        prog, OVERSAMPLE_MAX, BANK_MAX_CHANNELS, BATCH_BLOCK, ANALYZE_MAX_FFT, ASCII_MAX_COLS, ASCII_MAX_ROWS);
+}
+
+// A whole option value as a number ("10k", "2.5M"; see parse_number_span):
+// finite, and small enough for the float most settings are stored in.
+// Integer options check their own range before they cast.
+static int parse_value(const char *s, double *out)
+{
+    return parse_number_span(s, s + strlen(s), out) && fabs(*out) <= FLT_MAX;
+}
+
+// Output format names; returns 0 for an unknown name
+static int parse_format_name(const char *s, int *format, int *wav)
+{
+    static const struct { const char *name; int format, wav; } names[] = {
+        { "f32", FMT_F32, 0 }, { "s16", FMT_S16, 0 }, { "s24", FMT_S24, 0 },
+        { "wav16", FMT_S16, 1 }, { "wav24", FMT_S24, 1 }, { "wavf32", FMT_F32, 1 },
+        { "wav", FMT_S16, 1 },
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(s, names[i].name) == 0) {
+            *format = names[i].format;
+            *wav = names[i].wav;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parse_wave_name(const char *s)
+{
+    if (strcmp(s, "sine") == 0 || strcmp(s, "1") == 0) return 1;
+    if (strcmp(s, "square") == 0 || strcmp(s, "2") == 0) return 2;
+    if (strcmp(s, "triangle") == 0 || strcmp(s, "3") == 0) return 3;
+    if (strcmp(s, "sawtooth") == 0 || strcmp(s, "4") == 0) return 4;
+    if (strcmp(s, "awg") == 0 || strcmp(s, "5") == 0) return WAVE_AWG;
+#ifdef WAVEGEN_BAKED
+    if (strcmp(s, "baked") == 0) return WAVE_BAKED;
+#endif
+    return 0;
+}
+
+// Parses "am:fc=10k,m=0.5" style modulation specs
+static int parse_mod_spec(const char *spec, cli_job *job)
+{
+    char buf[128];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *args = strchr(buf, ':');
+    if (args) *args++ = '\0';
+
+    if (strcmp(buf, "am") == 0) { job->mod_type = MOD_AM; job->mod.index = 0.5f; }
+    else if (strcmp(buf, "fm") == 0) { job->mod_type = MOD_FM; job->mod.index = 1.0f; }
+    else if (strcmp(buf, "pwm") == 0) { job->mod_type = MOD_PWM; job->mod.fc = 50.0f; }
+    else if (strcmp(buf, "pm") == 0) { job->mod_type = MOD_PM; job->mod.index = 1.0f; }
+    else if (strcmp(buf, "none") == 0) { job->mod_type = 0; return 1; }
+    else return 0;
+
+    char *save = NULL;
+    for (char *kv = args ? strtok_r(args, ",", &save) : NULL; kv; kv = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(kv, '=');
+        double v;
+        if (!eq || !parse_value(eq + 1, &v)) return 0;
+        *eq = '\0';
+        if (strcmp(kv, "fc") == 0 || strcmp(kv, "f") == 0) job->mod.fc = (float)v;
+        else if (strcmp(kv, "Ac") == 0 || strcmp(kv, "ac") == 0) job->mod.Ac = (float)v;
+        else if (strcmp(kv, "m") == 0 || strcmp(kv, "beta") == 0) job->mod.index = (float)v;
+        else return 0;
+    }
+    return 1;
+}
+
+// Parses "exp:f0=20,f1=20k,T=10" sweep specs
+static int parse_sweep_spec(const char *spec, sweep_params *sp)
+{
+    char buf[128];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *args = strchr(buf, ':');
+    if (args) *args++ = '\0';
+
+    if (strcmp(buf, "lin") == 0) sp->law = SWEEP_LINEAR;
+    else if (strcmp(buf, "exp") == 0 || strcmp(buf, "log") == 0) sp->law = SWEEP_EXP;
+    else return 0;
+
+    char *save = NULL;
+    for (char *kv = args ? strtok_r(args, ",", &save) : NULL; kv; kv = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(kv, '=');
+        double v;
+        if (!eq || !parse_value(eq + 1, &v)) return 0;
+        *eq = '\0';
+        if (strcmp(kv, "f0") == 0) sp->f0 = (float)v;
+        else if (strcmp(kv, "f1") == 0) sp->f1 = (float)v;
+        else if (strcmp(kv, "T") == 0 || strcmp(kv, "t") == 0) sp->duration = v;
+        else return 0;
+    }
+    return sp->duration > 0.0;
+}
+
+// Parses "exact" or "timer:clk=72M"
+static int parse_pwm_out(const char *spec, cli_job *job)
+{
+    if (strcmp(spec, "exact") == 0) {
+        job->pwm_out = PWM_OUT_EXACT;
+        return 1;
+    }
+    if (strncmp(spec, "timer:clk=", 10) == 0 && parse_value(spec + 10, &job->timer_clk)) {
+        job->pwm_out = PWM_OUT_TIMER;
+        return job->timer_clk > 0.0;
+    }
+    return 0;
+}
+
+// Fills job from argv; returns 1 on success, 0 after printing an error
+static int parse_cli_args(int argc, char const *argv[], cli_job *job)
+{
+    memset(job, 0, sizeof(*job));
+    job->waveform_type = 1;
+    job->base.freq = 1.0f;
+    job->base.amp = 1.0f;
+    job->base.duty = 0.5f;
+    job->mod.Ac = 1.0f;
+    job->mod.fc = 1.0f;
+    job->rate = 48000.0;
+    job->samples = 48000;
+    job->format = FMT_F32;
+    job->fullscale = 1.0f;
+    job->threads = 1;
+    job->period = 1024;
+    job->channels = 1;
+    job->sweep.f0 = 20.0f;
+    job->sweep.f1 = 20000.0f;
+    job->awg_interp = AWG_LINEAR;
+    job->awg_mipmap = 1;
+    job->oversample = 1;
+    job->stopband = 100.0;
+    job->plot_cols = DEFAULT_SAMPLES;
+    job->plot_rows = ASCII_ROWS;
+    int samples_given = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        double v = 0.0;
+        int ok = 1;
+
+        if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+            print_cli_usage(argv[0]);
+            return 0;
+        }
+        if (!val) {
+            fprintf(stderr, "%s: missing value for %s\n", argv[0], opt);
+            return 0;
+        }
+
+        if (strcmp(opt, "--wave") == 0) ok = (job->waveform_type = parse_wave_name(val)) != 0;
+        else if (strcmp(opt, "--freq") == 0) { ok = parse_value(val, &v); job->base.freq = (float)v; }
+        else if (strcmp(opt, "--amp") == 0) { ok = parse_value(val, &v); job->base.amp = (float)v; }
+        else if (strcmp(opt, "--phase") == 0) ok = parse_phase_input_to_rad(val, &job->base.phase);
+        else if (strcmp(opt, "--duty") == 0) {
+            ok = parse_value(val, &v);
+            // Clamp duty cycle like the interactive menu does
+            job->base.duty = (float)(v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v));
+        }
+        else if (strcmp(opt, "--slope") == 0) ok = parse_value(val, &v); // Accepted, shape unaffected
+        else if (strcmp(opt, "--table") == 0) {
+            job->awg_path = val;
+            job->waveform_type = WAVE_AWG;
+        }
+        else if (strcmp(opt, "--interp") == 0) {
+            if (strcmp(val, "nearest") == 0) job->awg_interp = AWG_NEAREST;
+            else if (strcmp(val, "linear") == 0) job->awg_interp = AWG_LINEAR;
+            else if (strcmp(val, "cubic") == 0) job->awg_interp = AWG_CUBIC;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--mipmap") == 0) {
+            if (strcmp(val, "on") == 0) job->awg_mipmap = 1;
+            else if (strcmp(val, "off") == 0) job->awg_mipmap = 0;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--quality") == 0) {
+            if (strcmp(val, "naive") == 0) job->base.bandlimited = 0;
+            else if (strcmp(val, "blep") == 0) job->base.bandlimited = 1;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--mod") == 0) ok = parse_mod_spec(val, job);
+        else if (strcmp(opt, "--rate") == 0) { ok = parse_value(val, &v) && v >= 1.0 && v <= RATE_MAX; job->rate = v; }
+        else if (strcmp(opt, "--oversample") == 0) {
+            ok = parse_value(val, &v) && v >= 1.0 && v <= OVERSAMPLE_MAX;
+            if (ok) job->oversample = (int)v;
+            ok = ok && (double)job->oversample == v && !(job->oversample & (job->oversample - 1));
+        }
+        else if (strcmp(opt, "--stopband") == 0) {
+            ok = parse_value(val, &v) && v >= 40.0 && v <= 160.0;
+            job->stopband = v;
+        }
+        else if (strcmp(opt, "--samples") == 0) {
+            ok = parse_value(val, &v) && v >= 0.0 && v <= SAMPLES_MAX;
+            if (ok) job->samples = (uint64_t)v;
+            samples_given = 1;
+        }
+        else if (strcmp(opt, "--sweep") == 0) ok = parse_sweep_spec(val, &job->sweep);
+        else if (strcmp(opt, "--pwm-out") == 0) ok = parse_pwm_out(val, job);
+        else if (strcmp(opt, "--out") == 0) job->out_path = val;
+        else if (strcmp(opt, "--bake") == 0) job->bake_path = val;
+        else if (strcmp(opt, "--format") == 0) ok = parse_format_name(val, &job->format, &job->wav);
+        else if (strcmp(opt, "--io") == 0) {
+            if (strcmp(val, "stdio") == 0) job->mapped = 0;
+            else if (strcmp(val, "mmap") == 0) job->mapped = 1;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--fullscale") == 0) { ok = parse_value(val, &v) && v > 0.0; job->fullscale = (float)v; }
+        else if (strcmp(opt, "--threads") == 0) {
+            ok = parse_value(val, &v) && v >= 0.0 && v <= POOL_MAX_THREADS;
+            if (ok) job->threads = (v == 0.0) ? default_thread_count() : (int)v;
+        }
+        else if (strcmp(opt, "--stream") == 0) {
+            if (strcmp(val, "fast") == 0) job->stream = STREAM_FAST;
+            else if (strcmp(val, "realtime") == 0) job->stream = STREAM_REALTIME;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--control") == 0) ok = job->control = strcmp(val, "stdin") == 0;
+        else if (strcmp(opt, "--commands") == 0) job->commands = val;
+        else if (strcmp(opt, "--analyze") == 0) {
+            if (strcmp(val, "report") == 0) job->analyze = ANALYZE_REPORT;
+            else if (strcmp(val, "plot") == 0) job->analyze = ANALYZE_PLOT;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--mem-report") == 0) ok = job->mem_report = strcmp(val, "stderr") == 0;
+#if WAVEGEN_STATS
+        else if (strcmp(opt, "--stats") == 0) ok = job->stats = strcmp(val, "stderr") == 0;
+#endif
+        else if (strcmp(opt, "--channels") == 0) {
+            ok = parse_value(val, &v) && v >= 1.0 && v <= BANK_MAX_CHANNELS;
+            if (ok) job->channels = (int)v;
+        }
+        else if (strcmp(opt, "--chan-step") == 0) { ok = parse_value(val, &v); job->chan_step = (float)v; }
+        else if (strcmp(opt, "--layout") == 0) {
+            if (strcmp(val, "interleaved") == 0) job->layout = BANK_INTERLEAVED;
+            else if (strcmp(val, "planar") == 0) job->layout = BANK_PLANAR;
+            else ok = 0;
+        }
+        else if (strcmp(opt, "--period") == 0) {
+            ok = parse_value(val, &v) && v >= 1.0 && v <= (double)STREAM_BLOCK * STREAM_RING_BLOCKS;
+            if (ok) job->period = (size_t)v;
+        }
+        else if (strcmp(opt, "--plot-size") == 0) {
+            int w = 0, h = 0;
+            ok = sscanf(val, "%dx%d", &w, &h) == 2 && w >= 1 && w <= ASCII_MAX_COLS &&
+                 h >= 1 && h <= ASCII_MAX_ROWS;
+            job->plot_cols = w;
+            job->plot_rows = h;
+        }
+        else {
+            fprintf(stderr, "%s: unknown option %s\n", argv[0], opt);
+            print_cli_usage(argv[0]);
+            return 0;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "%s: bad value '%s' for %s\n", argv[0], val, opt);
+            return 0;
+        }
+        i++;
+    }
+
+#ifdef WAVEGEN_BAKED
+    if (job->waveform_type == WAVE_BAKED &&
+        (job->stream || job->mod_type || job->bake_path || job->channels > 1 || job->oversample > 1)) {
+        fprintf(stderr, "%s: the baked table only plays unmodulated in batch mode\n", argv[0]);
+        return 0;
+    }
+#endif
+    if (job->waveform_type == WAVE_AWG && (!job->awg_path || job->channels > 1)) {
+        fprintf(stderr, "%s: --wave awg needs a --table file and plays on one channel\n", argv[0]);
+        return 0;
+    }
+    if (job->sweep.law) {
+        if (job->mod_type || job->stream || job->bake_path || job->channels > 1 ||
+            job->threads > 1 || job->base.bandlimited || job->waveform_type > 4) {
+            fprintf(stderr, "%s: --sweep renders naive, unmodulated waves in plain batch mode\n", argv[0]);
+            return 0;
+        }
+        if (!samples_given) {
+            const double n = floor(job->sweep.duration * job->rate + 0.5);
+            if (n > SAMPLES_MAX) {
+                fprintf(stderr, "%s: --sweep T is longer than %g samples\n", argv[0], SAMPLES_MAX);
+                return 0;
+            }
+            job->samples = (uint64_t)n;
+        }
+    }
+    if (job->pwm_out && (job->mod_type != MOD_PWM || job->stream || job->sweep.law ||
+                         job->channels > 1 || job->bake_path || job->oversample > 1 ||
+                         job->threads > 1 || (job->mapped && job->pwm_out == PWM_OUT_TIMER))) {
+        fprintf(stderr, "%s: --pwm-out needs --mod pwm in plain serial batch mode\n", argv[0]);
+        return 0;
+    }
+    if (job->oversample > 1 && (job->stream || job->sweep.law || job->channels > 1 || job->bake_path)) {
+        fprintf(stderr, "%s: --oversample runs in plain batch mode\n", argv[0]);
+        return 0;
+    }
+    if (job->commands && (job->stream || job->sweep.law || job->channels > 1 || job->bake_path ||
+                          job->oversample > 1 || job->pwm_out || job->mapped ||
+                          job->waveform_type > WAVE_AWG)) {
+        fprintf(stderr, "%s: --commands renders one plain waveform through stdio\n", argv[0]);
+        return 0;
+    }
+    if (job->channels > 1 && (job->mod_type || job->stream || job->bake_path || job->threads > 1)) {
+        fprintf(stderr, "%s: --channels renders unmodulated banks in plain batch mode\n", argv[0]);
+        return 0;
+    }
+    if (job->layout == BANK_PLANAR && job->wav) {
+        fprintf(stderr, "%s: WAV output is always interleaved\n", argv[0]);
+        return 0;
+    }
+    if (job->mapped && (!job->out_path || strcmp(job->out_path, "-") == 0 || job->samples == 0)) {
+        fprintf(stderr, "%s: --io mmap needs an --out file and a --samples count\n", argv[0]);
+        return 0;
+    }
+    if (job->analyze && (job->bake_path || job->pwm_out == PWM_OUT_TIMER || job->layout == BANK_PLANAR ||
+                         (job->out_path && strcmp(job->out_path, "-") == 0))) {
+        fprintf(stderr, "%s: --analyze prints to stdout and reads sampled, interleaved output: "
+                        "not with --bake, --pwm-out timer, --layout planar or --out -\n", argv[0]);
+        return 0;
+    }
+    if (job->analyze && !job->out_path) job->out_path = "/dev/null";  // Analysis only
+    if (!job->out_path) {
+        if (job->bake_path) return 1;
+        fprintf(stderr, "%s: --out is required in batch mode\n", argv[0]);
+        return 0;
+    }
+    return 1;
+}
+
+// Opens the job's output for channels interleaved channels, mapped or not
+static int open_job_sink(const cli_job *job, sample_sink *s, int channels)
+{
+    const uint64_t total = job->samples * (uint64_t)channels;
+    const int ok = job->mapped ? sink_open_mapped(s, job->out_path, job->format, job->wav, job->rate,
+                                                  channels, job->fullscale, total)
+                               : sink_open(job->ctx, s, job->out_path, job->format, job->wav, job->rate,
+                                           channels, job->fullscale, total);
+    if (ok) s->tap = job->tap;
+    return ok;
+}
+
+// Unmodulated waveforms with a whole-sample period: render one tile of
+// periods and write it repeatedly. The output repeats its first period
+// exactly; the accumulator's sub-LSB drift per period is not reproduced,
+// so a sample that falls right on an edge keeps the first period's value.
+static int run_batch_tiled(const cli_job *job, sample_sink *sink, size_t period)
+{
+    wave_cache local, *cache = job->period_cache;
+    size_t tile_min = (job->samples < WAVE_CACHE_MIN_TILE) ? (size_t)job->samples
+                                                           : WAVE_CACHE_MIN_TILE;
+    if (!cache || cache->cap < tile_min + period) {
+        cache = &local;
+        wave_cache_init(cache, (float *)arena_alloc(&job->ctx->scratch, (tile_min + period) * sizeof(float)),
+                        tile_min + period);
+    }
+    const float *tile = wave_cache_get(job->ctx, cache, job->waveform_type, &job->base,
+                                       1.0 / job->rate, period, tile_min);
+    if (!tile) return 1;
+
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < cache->len) ? (size_t)(job->samples - done) : cache->len;
+        if (!sink_write(sink, tile, n)) { status = 1; break; }
+        done += n;
+    }
+    return status;
+}
+
+#if WAVEGEN_FIXED_POINT
+// s16 output straight from the integer generator; returns -1 if the job
+// needs the float path
+static int run_batch_q15(const cli_job *job, sample_sink *sink)
+{
+    wave_gen g;
+    wave_gen_q15 q;
+    wave_gen_init(&g, job->waveform_type, &job->base, job->mod_type, &job->mod,
+                  0.0, 1.0 / job->rate);
+    if (!wave_gen_q15_init(&q, &g, job->fullscale)) return -1;
+
+    int16_t *block = (int16_t *)arena_alloc(&job->ctx->scratch, BATCH_BLOCK * sizeof(int16_t));
+    if (!block) return 1;
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < BATCH_BLOCK) ? (size_t)(job->samples - done) : BATCH_BLOCK;
+        wave_gen_q15_render(&q, block, n);
+        if (!sink_write_q15(sink, block, n)) { status = 1; break; }
+        done += n;
+    }
+    return status;
+}
+#endif
+
+/*
+   --bake renders one period of an unmodulated configuration whose period
+   is a whole number of samples and writes it as a C header. Building with
+   -DWAVEGEN_BAKED='"that.h"' puts the table in const storage (flash on a
+   microcontroller) and --wave baked tiles it with no per-sample math.
+*/
+static int run_bake(const cli_job *job)
+{
+    static const char *const names[] = { "", "sine", "square", "triangle", "sawtooth", "awg" };
+    size_t period = (job->mod_type || job->waveform_type > WAVE_AWG) ? 0
+                  : wave_cache_exact_period(&job->base, job->rate);
+    if (!period) {
+        fprintf(stderr, "bake: needs an unmodulated waveform whose period is a whole number of samples\n");
+        return 1;
+    }
+
+    wave_cache cache;
+    wave_cache_init(&cache, (float *)arena_alloc(&job->ctx->scratch, period * sizeof(float)), period);
+    const float *y = wave_cache_get(job->ctx, &cache, job->waveform_type, &job->base,
+                                    1.0 / job->rate, period, period);
+    FILE *fp = y ? fopen(job->bake_path, "w") : NULL;
+    if (!fp) {
+        if (y) perror(job->bake_path);
+        return 1;
+    }
+
+    fprintf(fp, "/* One period of %s, %g Hz at %g Hz, amp %g, phase %g, duty %g%s.\n"
+                "   Written by --bake; build with -DWAVEGEN_BAKED='\"this file\"' */\n",
+            names[job->waveform_type], job->base.freq, job->rate, job->base.amp,
+            job->base.phase, job->base.duty, job->base.bandlimited ? ", blep" : "");
+    fprintf(fp, "#define WAVEGEN_BAKED_DESC \"%s %g Hz @ %g Hz\"\n",
+            names[job->waveform_type], job->base.freq, job->rate);
+    fprintf(fp, "#define WAVEGEN_BAKED_RATE %.17g\n", job->rate);
+    fprintf(fp, "#define WAVEGEN_BAKED_LEN %zu\n", period);
+    fprintf(fp, "static const float wavegen_baked[WAVEGEN_BAKED_LEN] = {\n");
+    for (size_t i = 0; i < period; i++) {
+        // 9 digits round-trip a float; "0" needs a point before the f suffix
+        char num[32];
+        snprintf(num, sizeof(num), "%.9g", y[i]);
+        fprintf(fp, "%s%s%sf,%s", (i % 8 == 0) ? "    " : " ", num,
+                strpbrk(num, ".eE") ? "" : ".0", (i % 8 == 7 || i + 1 == period) ? "\n" : "");
+    }
+    fprintf(fp, "};\n");
+
+    int status = (fclose(fp) == 0) ? 0 : 1;
+    if (status) perror(job->bake_path);
+    return status;
+}
+
+#ifdef WAVEGEN_BAKED
+// Writes the compiled-in period over and over, straight from the const table
+static int run_baked(const cli_job *job, sample_sink *sink)
+{
+    if (job->rate != WAVEGEN_BAKED_RATE)
+        fprintf(stderr, "warning: table was baked for %g Hz\n", (double)WAVEGEN_BAKED_RATE);
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < WAVEGEN_BAKED_LEN) ? (size_t)(job->samples - done)
+                                                             : WAVEGEN_BAKED_LEN;
+        if (!sink_write(sink, wavegen_baked, n)) return 1;
+        done += n;
+    }
+    return 0;
+}
+#endif
+
+// Streams the job through the block renderer; returns 0 on success
+static int run_batch(const cli_job *job)
+{
+    sample_sink sink;
+    if (!open_job_sink(job, &sink, 1)) return 1;
+
+#ifdef WAVEGEN_BAKED
+    if (job->waveform_type == WAVE_BAKED) {
+        int status = run_baked(job, &sink);
+        if (!sink_close(&sink)) status = 1;
+        return status;
+    }
+#endif
+
+#if WAVEGEN_FIXED_POINT
+    if (job->format == FMT_S16 && job->oversample == 1) {
+        int status = run_batch_q15(job, &sink);
+        if (status >= 0) {
+            if (!sink_close(&sink)) status = 1;
+            return status;
+        }
+    }
+#endif
+
+    size_t period = (job->mod_type || job->oversample > 1) ? 0
+                  : wave_cache_exact_period(&job->base, job->rate);
+    if (period && job->samples > 0) {
+        int status = run_batch_tiled(job, &sink, period);
+        if (!sink_close(&sink)) status = 1;
+        return status;
+    }
+
+    render_pool pool;
+    int parallel = job->threads > 1 && render_pool_start(job->ctx, &pool, job->threads);
+    const size_t block_len = parallel ? PARALLEL_BLOCK : BATCH_BLOCK;
+
+    // Oversampled, a block holds block_len samples at the high rate and
+    // decimates to block_len / ratio outputs
+    const size_t ratio = (size_t)job->oversample;
+    const size_t out_len = block_len / ratio;
+    decimator dec;
+    float *block = (float *)arena_alloc(&job->ctx->scratch, block_len * sizeof(float));
+    if (!block || !decimator_init(job->ctx, &dec, job->oversample, job->stopband, block_len)) {
+        if (parallel) render_pool_stop(&pool);
+        sink_close(&sink);
+        return 1;
+    }
+
+    // The generator starts early enough to fill the decimator's history,
+    // and the outputs of that pre-roll are dropped, so out[0] is still the
+    // sample at t = 0 (no pre-roll without oversampling)
+    const size_t preroll = (2 * dec.delay + ratio - 1) / ratio * ratio;
+    const double dt = 1.0 / (job->rate * (double)ratio);
+    wave_gen g;
+    wave_gen_init(&g, job->waveform_type, &job->base, job->mod_type, &job->mod,
+                  ((double)dec.delay - (double)preroll) * dt, dt);
+    if (preroll) {
+        wave_gen_render(&g, block, preroll);
+        decimator_run(&dec, block, preroll, block);
+    }
+
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < out_len) ? (size_t)(job->samples - done) : out_len;
+        // Mapped float32 output is rendered in place; the workers of the
+        // pool then write disjoint parts of the file directly
+        float *dst = sink_direct(&sink, n);
+        if (!dst) dst = block;
+        float *src = (ratio > 1) ? block : dst;
+        if (parallel) {
+            render_pool_render(&pool, &g, src, n * ratio);
+        } else {
+            wave_gen_render(&g, src, n * ratio);
+        }
+        if (ratio > 1) decimator_run(&dec, src, n * ratio, dst);
+        if (!sink_write(&sink, dst, n)) { status = 1; break; }
+        done += n;
+        STATS_POLL(&job->ctx->scratch);
+    }
+
+    if (parallel) render_pool_stop(&pool);
+    if (!sink_close(&sink)) status = 1;
+    return status;
+}
+
+// --sweep: one chirp generator, serial
+static int run_sweep(const cli_job *job)
+{
+    wave_sweep w;
+    if (!wave_sweep_init(&w, job->waveform_type, &job->base, &job->sweep, job->rate)) {
+        fprintf(stderr, "sweep: frequencies must lie in [0, rate) (exp: above 0) and T cover a sample\n");
+        return 1;
+    }
+    sample_sink sink;
+    if (!open_job_sink(job, &sink, 1)) return 1;
+    float *block = (float *)arena_alloc(&job->ctx->scratch, BATCH_BLOCK * sizeof(float));
+    if (!block) {
+        sink_close(&sink);
+        return 1;
+    }
+
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < BATCH_BLOCK) ? (size_t)(job->samples - done) : BATCH_BLOCK;
+        float *dst = sink_direct(&sink, n);
+        if (!dst) dst = block;
+        wave_sweep_render(&w, dst, n);
+        if (!sink_write(&sink, dst, n)) { status = 1; break; }
+        done += n;
+        STATS_POLL(&job->ctx->scratch);
+    }
+    if (!sink_close(&sink)) status = 1;
+    return status;
+}
+
+// --pwm-out exact: the PWM engine straight into the sink
+static int run_pwm_exact(const cli_job *job)
+{
+    pwm_engine e;
+    pwm_edge *edges = (pwm_edge *)arena_alloc(&job->ctx->scratch, (BATCH_BLOCK + 8) * sizeof(pwm_edge));
+    if (!edges) return 1;
+    if (!pwm_engine_init(&e, job->waveform_type, &job->base, job->mod.Ac, job->mod.fc,
+                         job->rate, edges, BATCH_BLOCK + 8)) {
+        fprintf(stderr, "pwm: the carrier needs a positive frequency up to rate / 2\n");
+        return 1;
+    }
+    sample_sink sink;
+    if (!open_job_sink(job, &sink, 1)) return 1;
+    float *block = (float *)arena_alloc(&job->ctx->scratch, BATCH_BLOCK * sizeof(float));
+    if (!block) {
+        sink_close(&sink);
+        return 1;
+    }
+
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < BATCH_BLOCK) ? (size_t)(job->samples - done) : BATCH_BLOCK;
+        pwm_engine_render(&e, block, n);
+        if (!sink_write(&sink, block, n)) { status = 1; break; }
+        done += n;
+        STATS_POLL(&job->ctx->scratch);
+    }
+    if (!sink_close(&sink)) status = 1;
+    return status;
+}
+
+// --pwm-out timer: one compare value per carrier period, ready to be
+// DMA'd into the timer's compare register. The period is rounded to whole
+// counts, so the carrier runs at clk / counts; --samples / --rate sets the
+// duration as for sampled output.
+static int run_pwm_timer(const cli_job *job)
+{
+    const double counts = floor(job->timer_clk / job->mod.fc + 0.5);
+    pwm_engine e;
+    if (counts < 2.0 || counts > 4294967295.0 ||
+        !pwm_engine_init(&e, job->waveform_type, &job->base, job->mod.Ac,
+                         job->timer_clk / counts, job->timer_clk, NULL, 0)) {
+        fprintf(stderr, "pwm: a carrier period must be 2 to 2^32 - 1 timer counts\n");
+        return 1;
+    }
+    const size_t width = (counts <= 65535.0) ? 2 : 4;
+    const double nperiods = ceil((double)job->samples / job->rate * (job->timer_clk / counts));
+    if (nperiods > SAMPLES_MAX) {
+        fprintf(stderr, "pwm: more than %g carrier periods\n", SAMPLES_MAX);
+        return 1;
+    }
+    const uint64_t periods = (uint64_t)nperiods;
+
+    FILE *fp = (strcmp(job->out_path, "-") == 0) ? stdout : fopen(job->out_path, "wb");
+    if (!fp) {
+        perror(job->out_path);
+        return 1;
+    }
+    unsigned char buf[4096];
+    int status = 0;
+    for (uint64_t done = 0; done < periods && !status; ) {
+        size_t k = 0;
+        for (; k + width <= sizeof(buf) && done < periods; k += width, done++) {
+            const uint32_t ccr = (uint32_t)lrint(pwm_engine_next_duty(&e) * counts);
+            if (width == 2) put_le16(buf + k, ccr);
+            else put_le32(buf + k, ccr);
+        }
+        if (fwrite(buf, 1, k, fp) != k) status = 1;
+    }
+    if (fp != stdout ? fclose(fp) != 0 : fflush(fp) != 0) status = 1;
+    if (status) perror(job->out_path);
+    return status;
+}
+
+// --channels: one bank, rendered a block of frames at a time
+static int run_batch_bank(const cli_job *job)
+{
+    const size_t nch = (size_t)job->channels;
+    sample_sink sink;
+    if (!open_job_sink(job, &sink, job->channels)) return 1;
+
+    // A block is BATCH_BLOCK samples whatever the channel count
+    const size_t block_frames = BATCH_BLOCK / nch;
+    osc_bank bank;
+    float *block = (float *)arena_alloc(&job->ctx->scratch, block_frames * nch * sizeof(float));
+    if (!block || !osc_bank_init(job->ctx, &bank, nch, job->rate, job->base.bandlimited)) {
+        sink_close(&sink);
+        return 1;
+    }
+    for (size_t c = 0; c < nch; c++) {
+        wave_params p = job->base;
+        p.freq += (float)c * job->chan_step;
+        osc_bank_set(&bank, c, job->waveform_type, &p);
+    }
+
+    int status = 0;
+    for (uint64_t done = 0; done < job->samples; ) {
+        size_t n = (job->samples - done < block_frames) ? (size_t)(job->samples - done) : block_frames;
+        float *dst = sink_direct(&sink, n * nch);
+        if (!dst) dst = block;
+        osc_bank_render(&bank, dst, n, job->layout);
+        if (!sink_write(&sink, dst, n * nch)) { status = 1; break; }
+        done += n;
+        STATS_POLL(&job->ctx->scratch);
+    }
+
+    if (!sink_close(&sink)) status = 1;
+    return status;
+}
+
+static volatile sig_atomic_t stream_interrupted;
+
+static void stream_on_sigint(int sig)
+{
+    (void)sig;
+    stream_interrupted = 1;
+}
+
+// Applies "key=value ..." to the control thread's copy; returns 0 on a bad token
+static int parse_control_line(char *line, wave_update *u)
+{
+    for (char *kv; (kv = next_token(&line)) != NULL; ) {
+        char *eq = strchr(kv, '=');
+        double v = 0.0;
+        if (!eq) return 0;
+        *eq++ = '\0';
+        const char *end = eq + strlen(eq);
+        if (strcmp(kv, "phase") == 0) {
+            if (!parse_phase_span(eq, end, &u->shape.phase)) return 0;
+            continue;
+        }
+        if (!parse_number_span(eq, end, &v) || fabs(v) > FLT_MAX) return 0;
+        if (strcmp(kv, "freq") == 0) u->shape.freq = (float)v;
+        else if (strcmp(kv, "amp") == 0) u->shape.amp = (float)v;
+        else if (strcmp(kv, "duty") == 0) u->shape.duty = (float)(v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v));
+        else if (strcmp(kv, "fc") == 0) u->fc = (float)v;
+        else if (strcmp(kv, "Ac") == 0 || strcmp(kv, "ac") == 0) u->Ac = (float)v;
+        else if (strcmp(kv, "m") == 0 || strcmp(kv, "beta") == 0) u->index = (float)v;
+        else if (strcmp(kv, "ramp") == 0 && v >= 0.0 && v < 4294967296.0) u->ramp = (uint32_t)v;
+        else return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    stream_engine *engine;
+    wave_update current;   // Settings as last published; lines edit this
+    _Atomic int quit;
+} stream_control;
+
+static void stream_control_line(stream_control *c, char *line)
+{
+    wave_update u = c->current;
+    u.ramp = 0;  // A ramp applies to its own line only
+    if (!parse_control_line(line, &u)) {
+        fprintf(stderr, "control: ignored bad line\n");
+        return;
+    }
+    c->current = u;
+    stream_update(c->engine, &u);
+}
+
+// Control thread: polls stdin so it can be told to quit and joined. Reads
+// the descriptor directly, since stdio buffering would hide lines from poll.
+static void *stream_control_main(void *arg)
+{
+    stream_control *c = (stream_control *)arg;
+    char line[256];
+    size_t len = 0;
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+
+    while (!atomic_load(&c->quit)) {
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        ssize_t got = read(STDIN_FILENO, line + len, sizeof(line) - 1 - len);
+        if (got <= 0) break;
+        len += (size_t)got;
+
+        char *start = line, *nl;
+        while ((nl = memchr(start, '\n', len - (size_t)(start - line))) != NULL) {
+            *nl = '\0';
+            stream_control_line(c, start);
+            start = nl + 1;
+        }
+        len -= (size_t)(start - line);
+        memmove(line, start, len);
+        if (len == sizeof(line) - 1) len = 0;  // Overlong line: drop it
+    }
+    return NULL;
+}
+
+/*
+   --stream drives the producer/ring/consumer engine the way a sound card
+   would. The consumer here is a file writer standing in for the device
+   callback: in realtime mode it wakes every period on an absolute
+   CLOCK_MONOTONIC deadline and takes whatever the ring holds (shortfalls
+   are written as silence and counted as underruns); in fast mode it waits
+   for a full period instead, so the output equals plain batch mode.
+*/
+static int run_stream(const cli_job *job)
+{
+    sample_sink sink;
+    if (!open_job_sink(job, &sink, 1)) return 1;
+
+    float *period = (float *)arena_alloc(&job->ctx->scratch, job->period * sizeof(float));
+    if (!period) {
+        sink_close(&sink);
+        return 1;
+    }
+
+    wave_gen g;
+    wave_gen_init(&g, job->waveform_type, &job->base, job->mod_type, &job->mod,
+                  0.0, 1.0 / job->rate);
+
+    stream_engine e;
+    if (!stream_start(job->ctx, &e, &g, job->samples)) {
+        fprintf(stderr, "stream: cannot start producer\n");
+        sink_close(&sink);
+        return 1;
+    }
+
+    stream_control ctl;
+    pthread_t ctl_thread;
+    int ctl_running = 0;
+    if (job->control) {
+        ctl.engine = &e;
+        ctl.current.shape = job->base;
+        ctl.current.Ac = job->mod.Ac;
+        ctl.current.fc = job->mod.fc;
+        ctl.current.index = job->mod.index;
+        ctl.current.ramp = 0;
+        atomic_init(&ctl.quit, 0);
+        ctl_running = pthread_create(&ctl_thread, NULL, stream_control_main, &ctl) == 0;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stream_on_sigint;
+    sigaction(SIGINT, &sa, NULL);
+
+    const long period_ns = (long)(1e9 * (double)job->period / job->rate);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    int status = 0;
+    uint64_t consumed = 0;
+    while (!stream_interrupted && (job->samples == 0 || consumed < job->samples)) {
+        size_t n = job->period;
+        if (job->samples && job->samples - consumed < n) n = (size_t)(job->samples - consumed);
+
+        if (job->stream == STREAM_REALTIME) {
+            deadline.tv_nsec += period_ns;
+            while (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_nsec -= 1000000000L;
+                deadline.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        } else {
+            // Fast mode: wait for a full period rather than underrun
+            while (atomic_load_explicit(&e.ring.head, memory_order_acquire)
+                   - atomic_load_explicit(&e.ring.tail, memory_order_relaxed) < n)
+                sleep_ns(10000);
+        }
+
+        stream_read(&e, period, n);
+        if (!sink_write(&sink, period, n)) { status = 1; break; }
+        consumed += n;
+        STATS_POLL(&job->ctx->scratch);
+    }
+
+    if (ctl_running) {
+        atomic_store(&ctl.quit, 1);
+        pthread_join(ctl_thread, NULL);
+    }
+    stream_stop(&e);
+    fprintf(stderr, "stream: %llu samples, %llu underruns, %llu overruns (producer waits on a full ring)\n",
+            (unsigned long long)consumed,
+            (unsigned long long)atomic_load(&e.ring.underruns),
+            (unsigned long long)atomic_load(&e.ring.overruns));
+
+    if (!sink_close(&sink)) status = 1;
+    return status;
+}
+
+/*
+   --commands FILE|- takes one command per line from a script or a pipe,
+   for hosts that drive the generator at high rates:
+     set sine.freq 1k       set sine.phase 90deg      set mod.fc 10k
+     wave square            render 4096               quit
+   set edits the settings of one waveform (freq amp phase duty slope) or
+   of the --mod modulator (fc Ac m beta), starting from the defaults of
+   the menus. wave picks what render appends and render N appends N samples to
+   --out, carrying on from where the last render stopped. Input is read
+   with read() and split in place, so a partial line never holds back the
+   complete ones before it; a bad line is reported and skipped.
+*/
+#define CMD_LINE_MAX 256   // Longer lines are reported and dropped
+
+typedef struct {
+    const cli_job *job;
+    sample_sink sink;
+    float *block;
+    wave_gen g;
+    int waveform_type;   // What render appends
+    int restart;         // 1 = set up g again before the next render
+    int changed;         // 1 = pass the settings to g before the next render
+    mod_params mod;
+    wave_settings settings;  // What set edits, one instance per session
+    uint64_t rendered;   // Samples written so far
+    int quit;
+} cmd_session;
+
+// Settings render plays for one waveform
+static wave_params cmd_shape(const cmd_session *c, int waveform_type)
+{
+    wave_params p = c->settings.wave[waveform_type];
+    p.bandlimited = c->job->base.bandlimited;
+    p.table = (waveform_type == WAVE_AWG) ? c->job->base.table : NULL;
+    return p;
+}
+
+static const char *cmd_set(cmd_session *c, char *key, const char *val)
+{
+    const char *end = val + strlen(val);
+    char *dot = strchr(key, '.');
+    double v;
+    if (!dot) return "expected WAVE.KEY or mod.KEY";
+    *dot++ = '\0';
+
+    if (strcmp(key, "mod") == 0) {
+        if (!parse_number_span(val, end, &v) || fabs(v) > FLT_MAX) return "bad number";
+        if (strcmp(dot, "fc") == 0) c->mod.fc = (float)v;
+        else if (strcmp(dot, "Ac") == 0 || strcmp(dot, "ac") == 0) c->mod.Ac = (float)v;
+        else if (strcmp(dot, "m") == 0 || strcmp(dot, "beta") == 0) c->mod.index = (float)v;
+        else return "unknown modulation key";
+        c->changed = 1;
+        return NULL;
+    }
+
+    const int w = parse_wave_name(key);
+    if (w < 1 || w > WAVE_AWG) return "unknown waveform";
+    wave_params *p = &c->settings.wave[w];
+    if (strcmp(dot, "phase") == 0) {
+        if (!parse_phase_span(val, end, &p->phase)) return "bad phase";
+    } else if (!parse_number_span(val, end, &v) || fabs(v) > FLT_MAX) {
+        return "bad number";
+    } else if (strcmp(dot, "freq") == 0) {
+        p->freq = (float)v;
+    } else if (strcmp(dot, "amp") == 0) {
+        p->amp = (float)v;
+    } else if (strcmp(dot, "duty") == 0) {
+        p->duty = (float)(v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v));
+    } else if (strcmp(dot, "slope") == 0) {
+        c->settings.slope = (float)v;  // Shown only, like the menu's slope
+    } else {
+        return "unknown key";
+    }
+    if (w == c->waveform_type) c->changed = 1;
+    return NULL;
+}
+
+static const char *cmd_render(cmd_session *c, uint64_t n)
+{
+    const cli_job *job = c->job;
+    const wave_params p = cmd_shape(c, c->waveform_type);
+    if (c->restart) {
+        wave_gen_init(&c->g, c->waveform_type, &p, job->mod_type, &c->mod,
+                      (double)c->rendered / job->rate, 1.0 / job->rate);
+    } else if (c->changed) {
+        const wave_update u = { p, c->mod.Ac, c->mod.fc, c->mod.index, 0 };
+        wave_gen_update(&c->g, &u);
+    }
+    c->restart = c->changed = 0;
+
+    for (uint64_t done = 0; done < n; ) {
+        size_t k = (n - done < BATCH_BLOCK) ? (size_t)(n - done) : BATCH_BLOCK;
+        wave_gen_render(&c->g, c->block, k);
+        if (!sink_write(&c->sink, c->block, k)) {
+            c->quit = 1;
+            return "cannot write --out";
+        }
+        done += k;
+        c->rendered += k;
+        STATS_POLL(&job->ctx->scratch);
+    }
+    return NULL;
+}
+
+// Runs one line; returns NULL or what was wrong with it
+static const char *cmd_exec(cmd_session *c, char *line)
+{
+    char *cmd = next_token(&line);
+    if (!cmd) return NULL;
+    char *arg = next_token(&line);
+    char *val = arg ? next_token(&line) : NULL;
+    const int nargs = !arg ? 0 : (!val ? 1 : 2);
+    if (next_token(&line)) return "too many arguments";
+    double v;
+
+    if (strcmp(cmd, "set") == 0) {
+        if (nargs != 2) return "usage: set WAVE.KEY VALUE";
+        return cmd_set(c, arg, val);
+    }
+    if (strcmp(cmd, "wave") == 0) {
+        const int w = (nargs == 1) ? parse_wave_name(arg) : 0;
+        if (w < 1 || w > WAVE_AWG) return "usage: wave sine|square|triangle|sawtooth|awg";
+        if (w == WAVE_AWG && !c->job->base.table) return "wave awg needs a --table file";
+        c->restart |= w != c->waveform_type;
+        c->waveform_type = w;
+        return NULL;
+    }
+    if (strcmp(cmd, "render") == 0) {
+        if (nargs != 1 || !parse_number_span(arg, arg + strlen(arg), &v) || v < 0.0 ||
+            v != floor(v) || v > SAMPLES_MAX)
+            return "usage: render SAMPLES";
+        return cmd_render(c, (uint64_t)v);
+    }
+    if (strcmp(cmd, "quit") == 0 && nargs == 0) {
+        c->quit = 1;
+        return NULL;
+    }
+    return "unknown command";
+}
+
+static int run_commands(const cli_job *job)
+{
+    const char *name = strcmp(job->commands, "-") == 0 ? "stdin" : job->commands;
+    const int fd = strcmp(job->commands, "-") == 0 ? STDIN_FILENO : open(job->commands, O_RDONLY);
+    if (fd < 0) {
+        perror(job->commands);
+        return 1;
+    }
+
+    cmd_session c;
+    memset(&c, 0, sizeof(c));
+    c.job = job;
+    c.waveform_type = job->waveform_type;
+    c.restart = 1;
+    c.mod = job->mod;
+    wave_settings_init(&c.settings);
+    c.settings.wave[job->waveform_type] = job->base;
+    c.block = (float *)arena_alloc(&job->ctx->scratch, BATCH_BLOCK * sizeof(float));
+    if (!c.block || !open_job_sink(job, &c.sink, 1)) {
+        if (fd != STDIN_FILENO) close(fd);
+        return 1;
+    }
+
+    char line[CMD_LINE_MAX];
+    size_t len = 0;
+    unsigned lineno = 0;
+    int bad = 0, dropping = 0, eof = 0;
+    while (!c.quit && !eof) {
+        ssize_t got = read(fd, line + len, sizeof(line) - 1 - len);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            // The last line may have no newline
+            eof = 1;
+            if (len == 0) break;
+            line[len++] = '\n';
+        } else {
+            len += (size_t)got;
+        }
+
+        char *start = line, *nl;
+        while (!c.quit && (nl = memchr(start, '\n', len - (size_t)(start - line))) != NULL) {
+            *nl = '\0';
+            lineno++;
+            const char *err = dropping ? NULL : cmd_exec(&c, start);
+            if (dropping) {
+                fprintf(stderr, "%s:%u: line longer than %d bytes\n", name, lineno, CMD_LINE_MAX - 1);
+                bad = 1;
+            } else if (err) {
+                fprintf(stderr, "%s:%u: %s\n", name, lineno, err);
+                bad = 1;
+            }
+            dropping = 0;
+            start = nl + 1;
+        }
+        len -= (size_t)(start - line);
+        memmove(line, start, len);
+        if (len == sizeof(line) - 1) {  // Overlong line: skip to its end
+            dropping = 1;
+            len = 0;
+        }
+    }
+
+    if (fd != STDIN_FILENO) close(fd);
+    if (!sink_close(&c.sink)) return 1;
+    return bad;
+}
+
+/*
+   --analyze report|plot keeps the first ANALYZE_MAX_FFT samples of
+   channel 0 as the sink wrote them (PCM output is read back in volts, so
+   quantization shows up in the noise) and prints the fundamental, its
+   harmonics, THD, SNR, SINAD, SFDR and ENOB; plot adds the spectrum in dB
+   relative to the fundamental. Without --out nothing is written. Float
+   output measures down to about -130 dB, the float FFT's own noise.
+*/
+#define ANALYZE_PLOT_FLOOR 140.0f  // dB below the fundamental at the plot's bottom row
+
+static void spectrum_plot(const cli_job *job, const float *db, size_t bins, double rate)
+{
+    const int cols = job->plot_cols, rows = job->plot_rows;
+    float yvals[ASCII_MAX_COLS];
+    const float half = 0.5f * ANALYZE_PLOT_FLOOR;
+    for (int c = 0; c < cols; c++) {
+        size_t lo = (size_t)c * bins / (size_t)cols, hi = (size_t)(c + 1) * bins / (size_t)cols;
+        if (hi <= lo) hi = lo + 1;
+        float top = -ANALYZE_PLOT_FLOOR;
+        for (size_t k = lo; k < hi && k < bins; k++) {
+            if (db[k] > top) top = db[k];
+        }
+        yvals[c] = (top + half) / half;
+    }
+    printf("\n0 dBc\n");
+    print_ascii_from_yvals(yvals, cols, rows, 1.0f);
+    printf("-%.0f dBc   0 Hz .. %.0f Hz, %.1f Hz per column\n", ANALYZE_PLOT_FLOOR, 0.5 * rate,
+           0.5 * rate / cols);
+}
+
+static int run_analysis(const cli_job *job, const sample_tap *tap)
+{
+    if (tap->len < ANALYZE_MIN_FFT) {
+        fprintf(stderr, "analyze: needs at least %d samples\n", ANALYZE_MIN_FFT);
+        return 1;
+    }
+    size_t n = ANALYZE_MAX_FFT;
+    while (n > tap->len) n >>= 1;
+    float *db = (job->analyze == ANALYZE_PLOT) ? (float *)arena_alloc(&job->ctx->scratch, (n / 2 + 1) * sizeof(float)) : NULL;
+    spectrum_report r;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ((job->analyze == ANALYZE_PLOT && !db) || !spectrum_analyze(job->ctx, tap->x, tap->len, job->rate, &r, db))
+        return 1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    printf("analysis: %zu-point FFT at %g Hz, 7-term Blackman-Harris window, %.2f ms\n", r.n, r.rate,
+           1e3 * ((double)(t1.tv_sec - t0.tv_sec) + 1e-9 * (double)(t1.tv_nsec - t0.tv_nsec)));
+    printf("fundamental  %.4f Hz, %.6f V peak, DC %.6f V\n", r.f0, r.amp, r.dc);
+    printf("harmonics   ");
+    for (int h = 2; h <= ANALYZE_HARMONICS; h++) {
+        if (r.harm_dbc[h] > -999.5) printf(" H%d %.1f", h, r.harm_dbc[h]);
+    }
+    printf(" dBc\n");
+    printf("THD          %.4f %% (%.2f dB)\n", r.thd_pct, r.thd_db);
+    printf("SNR          %.2f dB\n", r.snr_db);
+    printf("SINAD        %.2f dB (ENOB %.2f bits)\n", r.sinad_db, r.enob);
+    printf("SFDR         %.2f dBc\n", r.sfdr_db);
+    if (db) spectrum_plot(job, db, n / 2 + 1, job->rate);
+    return 0;
+}
+
+// Renders one parsed job; returns the exit status
+static int run_job(cli_job *job)
+{
+    if (job->awg_path) {
+        if (!awg_load(job->ctx, &job->awg, job->awg_path, job->awg_interp, job->awg_mipmap)) return 1;
+        job->base.table = &job->awg;
+    }
+    sample_tap tap = { NULL, 0, 0 };
+    if (job->analyze) {
+        tap.cap = (job->samples && job->samples < ANALYZE_MAX_FFT) ? (size_t)job->samples : ANALYZE_MAX_FFT;
+        tap.x = (float *)arena_alloc(&job->ctx->scratch, tap.cap * sizeof(float));
+        if (!tap.x) {
+            awg_unload(&job->awg);
+            return 1;
+        }
+        job->tap = &tap;
+    }
+    int status;
+    if (job->bake_path) status = run_bake(job);
+    else if (job->stream) status = run_stream(job);
+    else if (job->commands) status = run_commands(job);
+    else if (job->pwm_out == PWM_OUT_EXACT) status = run_pwm_exact(job);
+    else if (job->pwm_out == PWM_OUT_TIMER) status = run_pwm_timer(job);
+    else if (job->sweep.law) status = run_sweep(job);
+    else if (job->channels > 1) status = run_batch_bank(job);
+    else status = run_batch(job);
+    if (status == 0 && job->analyze) status = run_analysis(job, &tap);
+    job->tap = NULL;
+    awg_unload(&job->awg);
+    return status;
+}
+
+/* ---------- Job Files ---------- */
+
+/*
+   --jobs FILE renders many jobs in one process. Each line of FILE holds
+   the options of one job in command line syntax ('#' starts a comment,
+   "..." quotes a path with spaces); the other options on the command line
+   are defaults every line starts from. All lines are parsed and checked
+   before anything renders. Jobs that would render the same samples are
+   rendered once and the others get a copy of that output. The rest run
+   on --threads workers (default one per CPU, fewer if the arena cannot
+   give each JOBS_WORKER_BYTES), longest first: each worker has its own
+   slice of the scratch arena and its own period cache, which consecutive
+   periodic jobs with the same waveform reuse, and takes jobs from its own
+   deque until it is empty, then steals from another's tail.
+*/
+
+#define JOBS_MAX_ARGS 128      // Options and values on one line, defaults included
+#define JOBS_KEY_MAX 512       // Bytes of a job's render key
+// Smallest slice a worker gets: its period cache, a render block and a sink
+// buffer, plus alignment; --threads is lowered until every worker has this
+#define JOBS_WORKER_BYTES (2 * WAVE_CACHE_MIN_TILE * sizeof(float) + BATCH_BLOCK * sizeof(float) + \
+                           (size_t)SINK_CHUNK * 4 + 4 * ARENA_ALIGN)
+
+typedef struct {
+    int argc;
+    const char **argv;         // argv[0] is "FILE:LINE", so parse errors name the line
+    uint64_t hash;             // Of the render key
+    double cost;               // Samples to render, for longest-first ordering
+    int dup_of;                // Job whose output this one copies, -1 = render
+    const char *out;           // --out, checked to be unique
+} jobs_entry;
+
+typedef struct jobs_ctx jobs_ctx;
+
+typedef struct {
+    jobs_ctx *ctx;
+    pthread_t thread;
+    wavegen_ctx wg;            // Over its slice of the scratch arena
+    pthread_mutex_t lock;      // Guards head and tail
+    unsigned *items;           // Job indices; the owner pops the head, thieves the tail
+    size_t head, tail;
+} jobs_worker;
+
+struct jobs_ctx {
+    jobs_entry *jobs;
+    jobs_worker *workers;
+    int nworkers;
+    _Atomic unsigned failed;
+};
+
+// Serializes every option that changes the rendered bytes; jobs with equal
+// keys write identical output (thread count and I/O mode do not matter)
+static size_t job_key(const cli_job *j, unsigned char *key)
+{
+    size_t n = 0;
+#define JOB_KEY(x) (memcpy(key + n, &(x), sizeof(x)), n += sizeof(x))
+    JOB_KEY(j->waveform_type);
+    JOB_KEY(j->base.freq); JOB_KEY(j->base.amp); JOB_KEY(j->base.phase);
+    JOB_KEY(j->base.duty); JOB_KEY(j->base.bandlimited);
+    JOB_KEY(j->mod_type); JOB_KEY(j->mod.Ac); JOB_KEY(j->mod.fc); JOB_KEY(j->mod.index);
+    JOB_KEY(j->rate); JOB_KEY(j->samples); JOB_KEY(j->format); JOB_KEY(j->wav);
+    JOB_KEY(j->fullscale); JOB_KEY(j->channels); JOB_KEY(j->chan_step); JOB_KEY(j->layout);
+    JOB_KEY(j->sweep.law); JOB_KEY(j->sweep.f0); JOB_KEY(j->sweep.f1); JOB_KEY(j->sweep.duration);
+    JOB_KEY(j->oversample); JOB_KEY(j->stopband); JOB_KEY(j->pwm_out); JOB_KEY(j->timer_clk);
+    JOB_KEY(j->awg_interp); JOB_KEY(j->awg_mipmap);
+#undef JOB_KEY
+    const char *path = j->awg_path ? j->awg_path : "";
+    size_t len = strlen(path);
+    if (len > JOBS_KEY_MAX - n) len = JOBS_KEY_MAX - n;
+    memcpy(key + n, path, len);
+    return n + len;
+}
+
+static uint64_t fnv1a(const unsigned char *p, size_t n)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+static int jobs_same_render(const jobs_entry *a, const jobs_entry *b)
+{
+    cli_job ja, jb;
+    unsigned char ka[JOBS_KEY_MAX], kb[JOBS_KEY_MAX];
+    if (!parse_cli_args(a->argc, a->argv, &ja) || !parse_cli_args(b->argc, b->argv, &jb)) return 0;
+    const size_t na = job_key(&ja, ka), nb = job_key(&jb, kb);
+    return na == nb && memcmp(ka, kb, na) == 0;
+}
+
+// Splits a line in place into whitespace-separated tokens; returns the
+// count, or -1 if there are more than max or a quote is left open
+static int jobs_tokenize(char *line, const char **tok, int max)
+{
+    int n = 0;
+    for (char *p = line; ; ) {
+        while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+        if (*p == '\0' || *p == '#') return n;
+        if (n == max) return -1;
+        if (*p == '"') {
+            tok[n++] = ++p;
+            while (*p && *p != '"') p++;
+            if (*p != '"') return -1;
+        } else {
+            tok[n++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r') p++;
+            if (*p == '\0') return n;
+        }
+        *p++ = '\0';
+    }
+}
+
+// Copies the output a duplicate job shares with the job that rendered it
+static int jobs_copy_output(const char *from, const char *to)
+{
+    int fd = open(from, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(from);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    const size_t bytes = (size_t)st.st_size;
+    void *map = bytes ? mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(from);
+        return 1;
+    }
+    FILE *fp = fopen(to, "wb");
+    int status = !fp || fwrite(map, 1, bytes, fp) != bytes;
+    if (fp && fclose(fp) != 0) status = 1;
+    if (status) perror(to);
+    if (map) munmap(map, bytes);
+    return status;
+}
+
+// Next job for worker w: the head of its own deque, else the tail of the
+// first other deque with work left. Returns -1 once every deque is empty.
+static long jobs_take(jobs_ctx *c, int w)
+{
+    for (int k = 0; k < c->nworkers; k++) {
+        jobs_worker *v = &c->workers[(w + k) % c->nworkers];
+        long j = -1;
+        pthread_mutex_lock(&v->lock);
+        if (v->head < v->tail) j = (k == 0) ? (long)v->items[v->head++] : (long)v->items[--v->tail];
+        pthread_mutex_unlock(&v->lock);
+        if (j >= 0) return j;
+    }
+    return -1;
+}
+
+static void *jobs_worker_main(void *arg)
+{
+    jobs_worker *w = (jobs_worker *)arg;
+    jobs_ctx *c = w->ctx;
+    const int id = (int)(w - c->workers);
+    arena *scratch = &w->wg.scratch;
+
+    wave_cache cache;
+    const size_t cache_cap = 2 * WAVE_CACHE_MIN_TILE;
+    wave_cache_init(&cache, (float *)arena_alloc(scratch, cache_cap * sizeof(float)), cache_cap);
+    const size_t mark = arena_mark(scratch);
+
+    for (long j; (j = jobs_take(c, id)) >= 0; ) {
+        const jobs_entry *e = &c->jobs[j];
+        cli_job job;
+        int status = 1;
+        if (parse_cli_args(e->argc, e->argv, &job)) {
+            job.threads = 1;  // The workers are the parallelism
+            job.ctx = &w->wg;
+            job.period_cache = cache.buf ? &cache : NULL;
+            if (e->dup_of < 0) {
+                status = run_job(&job);
+            } else {
+                cli_job src;
+                const jobs_entry *d = &c->jobs[e->dup_of];
+                status = parse_cli_args(d->argc, d->argv, &src) ? jobs_copy_output(src.out_path, job.out_path) : 1;
+            }
+        }
+        if (status) {
+            fprintf(stderr, "%s: job failed\n", e->argv[0]);
+            c->failed++;
+        }
+        arena_release(scratch, mark);
+    }
+    arena_release(scratch, 0);  // The high-water mark stays for --mem-report
+    return NULL;
+}
+
+// Runs the listed jobs on every worker; order[] is dealt out round robin
+static void jobs_run_pass(jobs_ctx *c, const unsigned *order, size_t count)
+{
+    for (int w = 0; w < c->nworkers; w++) {
+        c->workers[w].head = c->workers[w].tail = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        jobs_worker *w = &c->workers[i % (size_t)c->nworkers];
+        w->items[w->tail++] = order[i];
+    }
+    int started = 0;
+    for (int w = 0; w < c->nworkers; w++) {
+        if (pthread_create(&c->workers[w].thread, NULL, jobs_worker_main, &c->workers[w]) != 0) break;
+        started++;
+    }
+    if (started == 0) {
+        // No threads: this one works through every deque in the first slice
+        jobs_worker_main(&c->workers[0]);
+    }
+    for (int w = 0; w < started; w++) pthread_join(c->workers[w].thread, NULL);
+}
+
+static const jobs_entry *jobs_sort_base;
+
+// Longest first, then file order
+static int jobs_by_cost(const void *a, const void *b)
+{
+    const jobs_entry *x = &jobs_sort_base[*(const unsigned *)a], *y = &jobs_sort_base[*(const unsigned *)b];
+    if (x->cost != y->cost) return (x->cost < y->cost) ? 1 : -1;
+    return (*(const unsigned *)a > *(const unsigned *)b) - (*(const unsigned *)a < *(const unsigned *)b);
+}
+
+static int run_jobs(wavegen_ctx *wg, int argc, char const *argv[])
+{
+    // Top-level options: the file, the worker count and the reports; all
+    // others are defaults for every line
+    const char *path = NULL;
+    int workers = default_thread_count(), stats = 0, mem_report = 0;
+    const char *defaults[JOBS_MAX_ARGS];
+    int ndefaults = 0;
+    for (int i = 1; i < argc; i += 2) {
+        const char *opt = argv[i], *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        double v = 0.0;
+        if (!val) {
+            fprintf(stderr, "%s: missing value for %s\n", argv[0], opt);
+            return 2;
+        }
+        if (strcmp(opt, "--jobs") == 0) path = val;
+        else if (strcmp(opt, "--threads") == 0) {
+            if (!parse_value(val, &v) || v < 0.0 || v > POOL_MAX_THREADS) {
+                fprintf(stderr, "%s: bad value '%s' for %s\n", argv[0], val, opt);
+                return 2;
+            }
+            if (v >= 1.0) workers = (int)v;
+        }
+        else if (strcmp(opt, "--mem-report") == 0) mem_report = strcmp(val, "stderr") == 0;
+        else if (strcmp(opt, "--stats") == 0) stats = strcmp(val, "stderr") == 0;
+        else if (ndefaults + 2 <= JOBS_MAX_ARGS) {
+            defaults[ndefaults++] = opt;
+            defaults[ndefaults++] = val;
+        }
+    }
+#if !WAVEGEN_STATS
+    (void)stats;
+#endif
+
+    // The whole file, NUL-terminated so its tokens can be used in place
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+    const size_t bytes = (size_t)st.st_size;
+    char *text = (char *)arena_alloc(&wg->scratch, bytes + 1);
+    size_t got = 0;
+    while (text && got < bytes) {
+        ssize_t r = read(fd, text + got, bytes - got);
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    close(fd);
+    if (!text || got != bytes) {
+        if (text) perror(path);
+        return 1;
+    }
+    text[bytes] = '\0';
+
+    size_t lines = 1;
+    for (size_t i = 0; i < bytes; i++) lines += text[i] == '\n';
+    jobs_entry *jobs = (jobs_entry *)arena_alloc(&wg->scratch, lines * sizeof(jobs_entry));
+    if (!jobs) return 1;
+
+    // Parse and check every line before rendering anything
+    size_t njobs = 0;
+    int bad = 0;
+    char *line = text;
+    for (unsigned ln = 1; line; ln++) {
+        char *nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        const char *tok[JOBS_MAX_ARGS];
+        int ntok = jobs_tokenize(line, tok, JOBS_MAX_ARGS - 1 - ndefaults);
+        line = nl ? nl + 1 : NULL;
+        if (ntok == 0) continue;
+
+        char label[64];
+        snprintf(label, sizeof(label), "%s:%u", path, ln);
+        if (ntok < 0) {
+            fprintf(stderr, "%s: too many options or an open quote\n", label);
+            bad = 1;
+            continue;
+        }
+        const int n = 1 + ndefaults + ntok;
+        const char **av = (const char **)arena_alloc(&wg->scratch, (size_t)n * sizeof(char *));
+        char *name = (char *)arena_alloc(&wg->scratch, strlen(label) + 1);
+        if (!av || !name) return 1;
+        strcpy(name, label);
+        av[0] = name;
+        memcpy(av + 1, defaults, (size_t)ndefaults * sizeof(char *));
+        memcpy(av + 1 + ndefaults, tok, (size_t)ntok * sizeof(char *));
+
+        cli_job job;
+        if (!parse_cli_args(n, av, &job)) {
+            bad = 1;
+            continue;
+        }
+        const char *out = job.bake_path ? job.bake_path : job.out_path;
+        if (!out || strcmp(out, "-") == 0 || job.stream || job.control || job.commands ||
+            job.analyze) {
+            fprintf(stderr, "%s: a job needs an --out file and cannot stream, read commands, or analyze\n", label);
+            bad = 1;
+            continue;
+        }
+        unsigned char key[JOBS_KEY_MAX];
+        jobs_entry *e = &jobs[njobs++];
+        e->argc = n;
+        e->argv = av;
+        e->hash = fnv1a(key, job_key(&job, key));
+        e->cost = (double)job.samples * job.channels * job.oversample;
+        e->dup_of = -1;
+        e->out = out;
+        if (job.bake_path) e->hash = (uint64_t)njobs;  // Headers are not deduplicated
+    }
+    if (bad) return 2;
+    if (njobs == 0) return 0;
+
+    // Duplicates: an open-addressed table of the first job per key
+    size_t slots = 1;
+    while (slots < 2 * njobs) slots <<= 1;
+    long *table = (long *)arena_alloc(&wg->scratch, slots * sizeof(long));
+    unsigned *order = (unsigned *)arena_alloc(&wg->scratch, njobs * sizeof(unsigned));
+    unsigned *copies = (unsigned *)arena_alloc(&wg->scratch, njobs * sizeof(unsigned));
+    if (!table || !order || !copies) return 1;
+    // Two jobs writing one file would race; reject those first
+    for (size_t i = 0; i < slots; i++) table[i] = -1;
+    for (size_t i = 0; i < njobs; i++) {
+        size_t h = (size_t)fnv1a((const unsigned char *)jobs[i].out, strlen(jobs[i].out)) & (slots - 1);
+        for (; table[h] >= 0; h = (h + 1) & (slots - 1)) {
+            if (strcmp(jobs[table[h]].out, jobs[i].out) == 0) {
+                fprintf(stderr, "%s: --out %s is also written by %s\n", jobs[i].argv[0],
+                        jobs[i].out, jobs[table[h]].argv[0]);
+                bad = 1;
+                break;
+            }
+        }
+        table[h] = (long)i;
+    }
+    if (bad) return 2;
+
+    for (size_t i = 0; i < slots; i++) table[i] = -1;
+    size_t nrender = 0, ncopy = 0;
+    for (size_t i = 0; i < njobs; i++) {
+        size_t h = (size_t)jobs[i].hash & (slots - 1);
+        for (; table[h] >= 0; h = (h + 1) & (slots - 1)) {
+            const jobs_entry *o = &jobs[table[h]];
+            if (o->hash == jobs[i].hash && jobs_same_render(o, &jobs[i])) {
+                jobs[i].dup_of = (int)table[h];
+                break;
+            }
+        }
+        if (jobs[i].dup_of >= 0) {
+            copies[ncopy++] = (unsigned)i;
+        } else {
+            table[h] = (long)i;
+            order[nrender++] = (unsigned)i;
+        }
+    }
+    jobs_sort_base = jobs;
+    qsort(order, nrender, sizeof(unsigned), jobs_by_cost);
+
+    // Workers, each with an equal slice of what is left of the arena, and no
+    // more of them than leaves every slice JOBS_WORKER_BYTES
+    if ((size_t)workers > njobs) workers = (int)njobs;
+    const size_t per_worker = JOBS_WORKER_BYTES + sizeof(jobs_worker) + njobs * sizeof(unsigned) + 2 * ARENA_ALIGN;
+    const size_t fit = (wg->scratch.cap - wg->scratch.used) / per_worker;
+    if ((size_t)workers > fit) workers = fit ? (int)fit : 1;
+    jobs_ctx ctx = { jobs, NULL, workers, 0 };
+    ctx.workers = (jobs_worker *)arena_alloc(&wg->scratch, (size_t)workers * sizeof(jobs_worker));
+    if (!ctx.workers) return 1;
+    for (int w = 0; w < workers; w++) {
+        jobs_worker *wk = &ctx.workers[w];
+        wk->ctx = &ctx;
+        wk->items = (unsigned *)arena_alloc(&wg->scratch, njobs * sizeof(unsigned));
+        if (!wk->items) return 1;
+        pthread_mutex_init(&wk->lock, NULL);
+    }
+    const size_t share = (wg->scratch.cap - wg->scratch.used) / (size_t)workers;
+    const size_t slice = (share > 2 * ARENA_ALIGN) ? (share - 2 * ARENA_ALIGN) / ARENA_ALIGN * ARENA_ALIGN : 0;
+    for (int w = 0; w < workers; w++) {
+        unsigned char *mem = (unsigned char *)arena_alloc(&wg->scratch, slice);
+        if (!mem) return 1;
+        wavegen_ctx_init(&ctx.workers[w].wg, mem, slice);
+        ctx.workers[w].wg.scratch.on_fail = wg->scratch.on_fail;
+    }
+
+    // Renders first, then the copies of their outputs
+    jobs_run_pass(&ctx, order, nrender);
+    if (ncopy) jobs_run_pass(&ctx, copies, ncopy);
+    for (int w = 0; w < workers; w++) pthread_mutex_destroy(&ctx.workers[w].lock);
+
+#if WAVEGEN_STATS
+    if (stats) stats_dump(stderr, &wg->scratch);
+#endif
+    for (int w = 0; mem_report && w < workers; w++) {
+        fprintf(stderr, "worker %d ", w);
+        arena_report(&ctx.workers[w].wg.scratch, stderr);
+    }
+    return ctx.failed ? 1 : 0;
+}
+
+// One line of --simd-check per kernel
+static void report_kernel(const char *name, int ok)
+{
+    printf("%-8s %s\n", name, ok ? "OK (bit-identical to scalar)" : "MISMATCH");
+}
+
+int run_cli(wavegen_ctx *ctx, int argc, char const *argv[])
+{
+    // Diagnostics that do not render anything
+    if (strcmp(argv[1], "--lut-report") == 0) {
+        sine_lut_report(ctx);
+        return 0;
+    }
+    if (strcmp(argv[1], "--simd-check") == 0) {
+        printf("Active kernels: %s\n", kernels_name());
+        return kernels_self_check(ctx, report_kernel) ? 0 : 1;
+    }
+#if WAVEGEN_FIXED_POINT
+    if (strcmp(argv[1], "--fixed-check") == 0) return q15_self_check(ctx) ? 0 : 1;
+#endif
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0) return run_jobs(ctx, argc, argv);
+    }
+
+    cli_job job;
+    int status = 0;
+    if (!parse_cli_args(argc, argv, &job)) return 2;
+    job.ctx = ctx;
+    status = run_job(&job);
+#if WAVEGEN_STATS
+    if (job.stats) stats_dump(stderr, &ctx->scratch);
+#endif
+    if (job.mem_report) arena_report(&ctx->scratch, stderr);
+    arena_reset(&ctx->scratch);
+    return status;
+}
+
@@ -0,0 +1,698 @@
+/*
+   wavegen_io.c
+   Waveform Generator host layer (libwavegen)
+
+   Everything declared in wavegen_io.h: output files, table files, plots
+   and reports, built on the core's block APIs.
+*/
+
+#define _POSIX_C_SOURCE 200809L  // sigaction, mmap, posix_madvise, ftruncate
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wavegen_io.h"
+
+/* ---------- Scratch Reports ---------- */
+
+void arena_print_failure(const arena *a, size_t bytes)
+{
+    fprintf(stderr, "scratch: %zu bytes requested, %zu free (WAVEGEN_ARENA_BYTES)\n",
+            bytes, a->cap - a->used);
+}
+
+void arena_report(const arena *a, FILE *fp)
+{
+    fprintf(fp, "scratch: high water %zu of %zu bytes (%.1f%%), %zu in use, %u failed\n",
+            a->high, a->cap, 100.0 * (double)a->high / (double)a->cap, a->used, a->failed);
+}
+
+/* ---------- ASCII Plots ---------- */
+
+// Renders into a frame buffer and emits the whole frame with one fwrite
+void print_ascii_from_yvals(const float *yvals, int cols, int rows, float amp)
+{
+    STAT_BEGIN();
+    char frame[ASCII_MAX_ROWS * (ASCII_MAX_COLS + 1)];  // Rows of cols chars plus '\n'
+    size_t size = render_ascii_frame(yvals, cols, rows, amp, frame, sizeof(frame));
+    if (size > 0) fwrite(frame, 1, size, stdout);
+    STAT_END(STAT_ASCII, (size_t)cols);
+}
+
+#if WAVEGEN_STATS
+/* ---------- Instrumentation ---------- */
+
+static volatile sig_atomic_t stats_requested;
+
+static void stats_on_sigusr1(int sig)
+{
+    (void)sig;
+    stats_requested = 1;
+}
+
+// Arms SIGUSR1 as the "dump now" request
+void stats_watch_signal(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stats_on_sigusr1;
+    sa.sa_flags = SA_RESTART;  // Menus blocked in scanf carry on
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+// Every slot with calls, then a's high-water mark (a may be NULL)
+void stats_dump(FILE *fp, const arena *a)
+{
+    fprintf(fp, "%-9s %10s %12s %10s %10s %9s %9s\n",
+            "stats", "calls", "samples", "total ms", "ns/call", "ns/samp", "cyc/samp");
+    for (int i = 0; i < STAT_SLOTS; i++) {
+        stat_totals t;
+        stats_read(i, &t);
+        if (t.calls == 0) continue;
+        if (i >= STAT_UNDERRUN) {
+            fprintf(fp, "%-9s %10llu\n", stat_name(i), (unsigned long long)t.calls);
+            continue;
+        }
+        fprintf(fp, "%-9s %10llu %12llu %10.3f %10.1f %9.3f %9.2f\n", stat_name(i),
+                (unsigned long long)t.calls, (unsigned long long)t.samples, (double)t.ns * 1e-6,
+                (double)t.ns / (double)t.calls,
+                t.samples ? (double)t.ns / (double)t.samples : 0.0,
+                t.samples ? (double)t.cycles / (double)t.samples : 0.0);
+    }
+    if (a) arena_report(a, fp);
+    fflush(fp);
+}
+
+// Called between blocks: serves a pending SIGUSR1 outside the handler
+void stats_poll(const arena *a)
+{
+    if (!stats_requested) return;
+    stats_requested = 0;
+    stats_dump(stderr, a);
+}
+#endif /* WAVEGEN_STATS */
+
+/* ---------- Diagnostics ---------- */
+
+// Prints max/RMS error of each table size and mode against the libm path
+void sine_lut_report(wavegen_ctx *ctx)
+{
+    const int probes = 1 << 20;
+    double ref_max, ref_rms;
+
+    printf("\n========== Sine LUT Error Report (%d phases) ==========\n", probes);
+    printf("Built with SINE_LUT_BITS = %d, SINE_LUT_INTERP = %d\n\n", SINE_LUT_BITS, SINE_LUT_INTERP);
+
+    // Baseline: error of sinf() itself at the 24-bit phase resolution
+    sine_lut_reference_error(probes, &ref_max, &ref_rms);
+    printf("sinf() reference: max %.3e  rms %.3e\n\n", ref_max, ref_rms);
+
+    printf("entries\tbytes\tnearest max\tnearest rms\tlinear max\tlinear rms\n");
+    for (int bits = 8; bits <= 16; bits += 2) {
+        sine_lut_error e;
+        if (!sine_lut_measure(ctx, bits, probes, &e)) return;
+        printf("%d\t%d\t%.3e\t%.3e\t%.3e\t%.3e%s\n", 1 << bits,
+               (int)(((1 << (bits - 2)) + 1) * sizeof(float)),
+               e.near_max, e.near_rms, e.lin_max, e.lin_rms,
+               bits == SINE_LUT_BITS ? "\t<- built" : "");
+    }
+    printf("========================================================\n");
+}
+
+#if WAVEGEN_FIXED_POINT
+/* --fixed-check: renders every supported case through both paths and
+   reports the largest difference in s16 LSBs */
+// Renders one case both ways and prints how far the Q15 output strays
+static int q15_check_case(float *ref, int16_t *got, size_t n, const char *name, int w,
+                          const wave_params *wp, int mod_type, const mod_params *mp, long tol)
+{
+    wave_gen g;
+    wave_gen_q15 q;
+    wave_gen_init(&g, w, wp, mod_type, mp, 0.0, 1.0 / 48000.0);
+    wave_gen_q15_init(&q, &g, 1.0f);
+    wave_gen_render(&g, ref, n);
+    wave_gen_q15_render(&q, got, n);
+
+    long worst = 0;
+    size_t off = 0;
+    for (size_t i = 0; i < n; i++) {
+        float v = ref[i] * 32767.0f;
+        if (v > 32767.0f) v = 32767.0f;
+        if (v < -32767.0f) v = -32767.0f;
+        long d = labs(lrintf(v) - got[i]);
+        if (d > tol) off++;
+        if (d > worst) worst = d;
+    }
+    // PWM may flip isolated samples; everything else must stay within tol
+    int ok = (mod_type == MOD_PWM) ? off * 10000 < n : off == 0;
+    printf("%-17s max %6ld LSB, %6zu samples > %ld LSB  %s\n", name, worst, off, tol, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+int q15_self_check(wavegen_ctx *ctx)
+{
+    const size_t n = 1u << 20;
+    const size_t mark = arena_mark(&ctx->scratch);
+    float *ref = (float *)arena_alloc(&ctx->scratch, n * sizeof(float));
+    int16_t *got = (int16_t *)arena_alloc(&ctx->scratch, n * sizeof(int16_t));
+    if (!ref || !got) { arena_release(&ctx->scratch, mark); return 0; }
+
+    static const char *const wave_names[] = { "", "sine", "square", "triangle", "sawtooth" };
+    static const char *const mod_names[] = { "", " + AM", "", " + PWM" };
+    const int mods[] = { 0, MOD_AM, MOD_PWM };
+    const wave_params wp = { 1234.5f, 0.8f, 0.3f, 0.3f, 0, NULL };
+    const mod_params mp = { 0.9f, 9876.5f, 0.5f, 0.0f, 0.0f };
+    int all_ok = 1;
+
+    for (int w = 1; w <= 4; w++) {
+        for (int k = 0; k < 3; k++) {
+            char name[32];
+            snprintf(name, sizeof(name), "%-8s%s", wave_names[w], mod_names[mods[k]]);
+            all_ok &= q15_check_case(ref, got, n, name, w, &wp, mods[k], &mp, 3);
+        }
+    }
+    // AM at the largest gains the integer path accepts, Ac at twice full
+    // scale and m at its clamp of 4: no overflow, and the base signal's
+    // 3 LSB scaled by the gain Ac * (1 + m) = 10
+    const mod_params mp_max = { 2.0f, 9876.5f, 4.0f, 0.0f, 0.0f };
+    for (int w = 1; w <= 4; w++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%-8s + AM peak", wave_names[w]);
+        all_ok &= q15_check_case(ref, got, n, name, w, &wp, MOD_AM, &mp_max, 30);
+    }
+    arena_release(&ctx->scratch, mark);
+    return all_ok;
+}
+#endif
+
+/* ---------- AWG Table Files ---------- */
+
+static uint32_t get_le16(const unsigned char *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8; }
+static uint32_t get_le32(const unsigned char *p) { return get_le16(p) | get_le16(p + 2) << 16; }
+
+// Channel 0 of a PCM 16/24/32-bit or float32 WAV, converted into the arena
+static float *awg_from_wav(wavegen_ctx *ctx, const unsigned char *b, size_t bytes, size_t *len)
+{
+    uint32_t fmt = 0, channels = 0, bits = 0;
+    const unsigned char *data = NULL;
+    size_t data_len = 0;
+    for (size_t p = 12; p + 8 <= bytes; ) {
+        size_t size = get_le32(b + p + 4);
+        const unsigned char *body = b + p + 8;
+        if (size > bytes - (p + 8)) size = bytes - (p + 8);  // Truncated: take what is there
+        if (memcmp(b + p, "fmt ", 4) == 0 && size >= 16) {
+            fmt = get_le16(body);
+            channels = get_le16(body + 2);
+            bits = get_le16(body + 14);
+            if (fmt == 0xFFFE && size >= 26) fmt = get_le16(body + 24);  // Extensible: sub-format
+        } else if (memcmp(b + p, "data", 4) == 0) {
+            data = body;
+            data_len = size;
+        }
+        p += 8 + size + (size & 1);
+    }
+    if (!data || channels == 0 ||
+        !((fmt == 1 && (bits == 16 || bits == 24 || bits == 32)) || (fmt == 3 && bits == 32)))
+        return NULL;
+
+    const size_t frame = (size_t)channels * (bits / 8);
+    *len = data_len / frame;
+    float *out = (*len && *len <= AWG_MAX_LEN)
+               ? (float *)arena_alloc(&ctx->scratch, *len * sizeof(float)) : NULL;
+    if (!out) return NULL;
+    for (size_t i = 0; i < *len; i++) {
+        const unsigned char *s = data + i * frame;
+        uint32_t u;
+        float f;
+        switch (bits) {
+            case 16: out[i] = (float)(int16_t)get_le16(s) * (1.0f / 32768.0f); break;
+            case 24:
+                u = (uint32_t)s[0] << 8 | (uint32_t)s[1] << 16 | (uint32_t)s[2] << 24;
+                out[i] = (float)(int32_t)u * (1.0f / 2147483648.0f);
+                break;
+            default:
+                u = get_le32(s);
+                if (fmt == 3) { memcpy(&f, &u, sizeof(f)); out[i] = f; }
+                else out[i] = (float)(int32_t)u * (1.0f / 2147483648.0f);
+                break;
+        }
+    }
+    return out;
+}
+
+static int awg_is_sep(char c) { return c == ',' || c == ';' || isspace((unsigned char)c); }
+
+// The last number on each line of a CSV or text table ("y" or "t,y");
+// blank lines, '#' comments and headers are skipped. Fields are copied to
+// a small buffer for strtod, since the mapping is not NUL-terminated.
+// With out NULL only counts.
+static size_t awg_scan_text(const char *s, size_t bytes, float *out)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < bytes; ) {
+        size_t end = i;
+        while (end < bytes && s[end] != '\n') end++;
+        size_t first = i;
+        while (first < end && isspace((unsigned char)s[first])) first++;
+        size_t stop = end;
+        while (stop > first && awg_is_sep(s[stop - 1])) stop--;
+        size_t start = stop;
+        while (start > first && !awg_is_sep(s[start - 1])) start--;
+
+        char tok[64];
+        const size_t k = stop - start;
+        if (k > 0 && k < sizeof(tok) && s[first] != '#') {
+            memcpy(tok, s + start, k);
+            tok[k] = '\0';
+            char *e;
+            double v = strtod(tok, &e);
+            if (*e == '\0') {
+                if (out) out[count] = (float)v;
+                count++;
+            }
+        }
+        i = end + 1;
+    }
+    return count;
+}
+
+static int awg_is_text(const char *path)
+{
+    const char *dot = strrchr(path, '.');
+    if (!dot) return 0;
+    char ext[8] = { 0 };
+    for (size_t i = 0; i + 1 < sizeof(ext) && dot[i + 1]; i++) ext[i] = (char)tolower((unsigned char)dot[i + 1]);
+    return strcmp(ext, "csv") == 0 || strcmp(ext, "txt") == 0;
+}
+
+// Maps path and takes one period from it: "RIFF" files as WAV, .csv and
+// .txt as text, anything else as raw little-endian float32. Raw float32 on
+// a little-endian host is played from the mapping; the rest is converted
+// into ctx's arena, which also holds the mipmaps. Returns 0 with a
+// message on stderr if the file gives no usable table.
+int awg_load(wavegen_ctx *ctx, awg_table *t, const char *path, int interp, int mipmap)
+{
+    memset(t, 0, sizeof(*t));
+    t->interp = interp;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "%s: empty or unreadable\n", path);
+        close(fd);
+        return 0;
+    }
+    const size_t bytes = (size_t)st.st_size;
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return 0;
+    }
+    posix_madvise(map, bytes, POSIX_MADV_SEQUENTIAL);
+
+    const unsigned char *b = (const unsigned char *)map;
+    const size_t mark = arena_mark(&ctx->scratch);
+    const float *data = NULL;
+    size_t len = 0;
+    int keep_map = 0;
+    if (bytes >= 12 && memcmp(b, "RIFF", 4) == 0 && memcmp(b + 8, "WAVE", 4) == 0) {
+        data = awg_from_wav(ctx, b, bytes, &len);
+    } else if (awg_is_text(path)) {
+        len = awg_scan_text((const char *)b, bytes, NULL);
+        float *f = (len && len <= AWG_MAX_LEN)
+                 ? (float *)arena_alloc(&ctx->scratch, len * sizeof(float)) : NULL;
+        if (f) awg_scan_text((const char *)b, bytes, f);
+        data = f;
+    } else if (bytes % sizeof(float) == 0 && bytes / sizeof(float) <= AWG_MAX_LEN) {
+        len = bytes / sizeof(float);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        data = (const float *)map;  // Page aligned
+        keep_map = 1;
+#else
+        float *f = (float *)arena_alloc(&ctx->scratch, len * sizeof(float));
+        for (size_t i = 0; f && i < len; i++) {
+            uint32_t u = get_le32(b + 4 * i);
+            memcpy(&f[i], &u, sizeof(u));
+        }
+        data = f;
+#endif
+    }
+
+    if (!awg_build(ctx, t, data, len, interp, mipmap)) {
+        fprintf(stderr, "%s: no table found (raw float32, .csv/.txt numbers, or PCM/float WAV; "
+                        "at most %u entries)\n", path, AWG_MAX_LEN);
+        arena_release(&ctx->scratch, mark);
+        munmap(map, bytes);
+        return 0;
+    }
+    // Loading bumped the cache version: the same arena slot may hold a new table
+    if (keep_map) {
+        t->map = map;
+        t->map_len = bytes;
+    } else {
+        munmap(map, bytes);
+    }
+    return 1;
+}
+
+// Drops the file mapping; arena memory goes with the next reset
+void awg_unload(awg_table *t)
+{
+    if (t->map) munmap(t->map, t->map_len);
+    memset(t, 0, sizeof(*t));
+}
+
+/* ---------- Binary Output Sinks ---------- */
+
+#define SINK_SYNC_CHUNK ((size_t)64 << 20)  // Mapped bytes written back per msync
+
+static int sink_sample_bytes(int format)
+{
+    return format == FMT_S16 ? 2 : (format == FMT_S24 ? 3 : 4);
+}
+
+void put_le16(unsigned char *p, uint32_t v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+void put_le32(unsigned char *p, uint32_t v) { put_le16(p, v); put_le16(p + 2, v >> 16); }
+
+#define WAV_DATA_ALIGN 16   // Float samples start on this file offset
+#define WAV_HEADER_MAX 96   // Largest header wav_header writes (float: 80 bytes)
+
+// Canonical 44-byte header (46 + fact chunk for float, which the spec asks for,
+// plus JUNK padding); frames counts samples of all channels, as sample_sink does
+static size_t wav_header(unsigned char *h, int format, double rate, int channels, uint64_t frames)
+{
+    const uint32_t bytes = (uint32_t)sink_sample_bytes(format);
+    const uint32_t align = bytes * (uint32_t)channels;
+    const int is_float = (format == FMT_F32);
+    const uint32_t fmt_size = is_float ? 18u : 16u;
+    const size_t base = 12 + 8 + fmt_size + (is_float ? 12 : 0) + 8;
+    // A JUNK chunk moves float samples onto a WAV_DATA_ALIGN boundary, so a
+    // mapped file can be rendered into in place (sink_direct)
+    const uint32_t junk = is_float ? (uint32_t)((WAV_DATA_ALIGN - (base + 8) % WAV_DATA_ALIGN) % WAV_DATA_ALIGN) : 0;
+    const size_t header = base + (is_float ? 8 + junk : 0);
+    uint64_t data = frames * bytes;
+    if (data > 0xFFFFFFFFu - header) data = 0xFFFFFFFFu - header; // RIFF size limit
+    unsigned char *p = h;
+
+    memcpy(p, "RIFF", 4); put_le32(p + 4, (uint32_t)(header - 8 + data)); memcpy(p + 8, "WAVE", 4); p += 12;
+    memcpy(p, "fmt ", 4); put_le32(p + 4, fmt_size); p += 8;
+    put_le16(p, is_float ? 3u : 1u);                    // 1 = PCM, 3 = IEEE float
+    put_le16(p + 2, (uint32_t)channels);
+    put_le32(p + 4, (uint32_t)rate);
+    put_le32(p + 8, (uint32_t)rate * align);            // Byte rate
+    put_le16(p + 12, align);                            // Block align
+    put_le16(p + 14, bytes * 8u);                       // Bits per sample
+    if (is_float) put_le16(p + 16, 0u);                 // cbSize
+    p += fmt_size;
+    if (is_float) { memcpy(p, "fact", 4); put_le32(p + 4, 4u); put_le32(p + 8, (uint32_t)(frames / (uint32_t)channels)); p += 12; }
+    if (is_float) { memcpy(p, "JUNK", 4); put_le32(p + 4, junk); memset(p + 8, 0, junk); p += 8 + junk; }
+    memcpy(p, "data", 4); put_le32(p + 4, (uint32_t)data);
+    return header;
+}
+
+int sink_open(wavegen_ctx *ctx, sample_sink *s, const char *path, int format, int wav,
+              double rate, int channels, float fullscale, uint64_t frames_hint)
+{
+    memset(s, 0, sizeof(*s));
+    s->path = path;
+    s->format = format;
+    s->wav = wav;
+    s->rate = rate;
+    s->channels = (channels > 0) ? channels : 1;
+    s->fullscale = (fullscale > 0.0f) ? fullscale : 1.0f;
+    s->frames_hint = frames_hint;
+
+    s->buf = (unsigned char *)arena_alloc(&ctx->scratch, (size_t)SINK_CHUNK * 4);
+    if (!s->buf) return 0;
+
+    s->fp = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+    if (!s->fp) { perror(path); return 0; }
+    // Blocks are already large, so skip the extra copy through the stdio buffer
+    setvbuf(s->fp, NULL, _IONBF, 0);
+
+    if (wav) {
+        unsigned char h[WAV_HEADER_MAX];
+        size_t len = wav_header(h, format, rate, s->channels, frames_hint);
+        if (fwrite(h, 1, len, s->fp) != len) {
+            // A failed open is never passed to sink_close
+            perror(path);
+            if (s->fp != stdout) fclose(s->fp);
+            s->fp = NULL;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t sink_convert(const sample_sink *s, const float *x, size_t n, unsigned char *out);
+
+// Output file mapped at its final size: the WAV header goes in place and the
+// samples are stored into the mapping, so there is no stdio or conversion
+// buffer copy. frames is the total sample count and must be known up front.
+int sink_open_mapped(sample_sink *s, const char *path, int format, int wav,
+                     double rate, int channels, float fullscale, uint64_t frames)
+{
+    memset(s, 0, sizeof(*s));
+    s->path = path;
+    s->format = format;
+    s->wav = wav;
+    s->rate = rate;
+    s->channels = (channels > 0) ? channels : 1;
+    s->fullscale = (fullscale > 0.0f) ? fullscale : 1.0f;
+    s->frames_hint = frames;
+
+    unsigned char h[WAV_HEADER_MAX];
+    s->data_off = wav ? wav_header(h, format, rate, s->channels, frames) : 0;
+    assert(format != FMT_F32 || s->data_off % WAV_DATA_ALIGN == 0);  // sink_direct relies on it
+    const uint64_t len = (uint64_t)s->data_off + frames * (uint64_t)sink_sample_bytes(format);
+    if (frames == 0 || len > (uint64_t)SIZE_MAX || (off_t)len < 0) {
+        fprintf(stderr, "%s: cannot map %llu samples\n", path, (unsigned long long)frames);
+        return 0;
+    }
+    s->map_len = (size_t)len;
+
+    s->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (s->fd < 0) { perror(path); return 0; }
+    if (ftruncate(s->fd, (off_t)len) != 0) {
+        perror(path);
+        close(s->fd);
+        return 0;
+    }
+    void *m = mmap(NULL, s->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (m == MAP_FAILED) {
+        perror(path);
+        close(s->fd);
+        return 0;
+    }
+    s->map = (unsigned char *)m;
+    posix_madvise(m, s->map_len, POSIX_MADV_SEQUENTIAL);
+    memcpy(s->map, h, s->data_off);
+    return 1;
+}
+
+// Where the next n samples can be rendered in place: only a mapped float32
+// sink on a little-endian host with 4-byte aligned sample data qualifies.
+// Returns NULL otherwise; pass the pointer on to sink_write either way.
+float *sink_direct(sample_sink *s, size_t n)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (s->map && s->format == FMT_F32 && s->data_off % sizeof(float) == 0 &&
+        s->frames + n <= s->frames_hint)
+        return (float *)(void *)(s->map + s->data_off) + s->frames;
+#endif
+    (void)s;
+    (void)n;
+    return NULL;
+}
+
+// Starts writeback of every whole page up to the write position, at most once
+// per SINK_SYNC_CHUNK so the dirty set stays bounded on multi-GB files
+static void sink_sync(sample_sink *s, int all)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = s->data_off + (size_t)s->frames * (size_t)sink_sample_bytes(s->format);
+    if (!all && end - s->synced < SINK_SYNC_CHUNK) return;
+    if (!all) end -= end % page;
+    msync(s->map + s->synced, end - s->synced, all ? MS_SYNC : MS_ASYNC);
+    s->synced = end;
+}
+
+// Mapped sink_write: converts into the mapping, or just accounts for
+// samples that were rendered there through sink_direct
+static int sink_write_mapped(sample_sink *s, const float *x, size_t n)
+{
+    if (s->frames + n > s->frames_hint) {
+        fprintf(stderr, "%s: more samples than the mapped size\n", s->path);
+        return 0;
+    }
+    unsigned char *dst = s->map + s->data_off + (size_t)s->frames * (size_t)sink_sample_bytes(s->format);
+    if ((const void *)x != (const void *)dst) sink_convert(s, x, n, dst);
+    s->frames += n;
+    sink_sync(s, 0);
+    return 1;
+}
+
+// Converts the float samples to the sink format; returns bytes produced
+static size_t sink_convert(const sample_sink *s, const float *x, size_t n, unsigned char *out)
+{
+    const float k16 = 32767.0f / s->fullscale, k24 = 8388607.0f / s->fullscale;
+    unsigned char *p = out;
+
+    switch (s->format) {
+        case FMT_S16:
+            for (size_t i = 0; i < n; i++, p += 2) {
+                float v = x[i] * k16;
+                if (v > 32767.0f) v = 32767.0f;
+                if (v < -32767.0f) v = -32767.0f;
+                put_le16(p, (uint32_t)(int32_t)lrintf(v));
+            }
+            break;
+        case FMT_S24:
+            for (size_t i = 0; i < n; i++, p += 3) {
+                float v = x[i] * k24;
+                if (v > 8388607.0f) v = 8388607.0f;
+                if (v < -8388607.0f) v = -8388607.0f;
+                uint32_t u = (uint32_t)(int32_t)lrintf(v);
+                p[0] = (unsigned char)u; p[1] = (unsigned char)(u >> 8); p[2] = (unsigned char)(u >> 16);
+            }
+            break;
+        default: // Little-endian float32
+            for (size_t i = 0; i < n; i++, p += 4) {
+                uint32_t u;
+                memcpy(&u, &x[i], 4);
+                put_le32(p, u);
+            }
+            break;
+    }
+    return (size_t)(p - out);
+}
+
+// Copies channel 0 into the tap until it is full, rounded the way the
+// PCM formats store it
+static void sink_tap(sample_sink *s, const float *x, size_t n)
+{
+    sample_tap *t = s->tap;
+    const size_t ch = (size_t)s->channels;
+    const float full = (s->format == FMT_S16) ? 32767.0f : 8388607.0f;
+    const float k = full / s->fullscale;
+    for (size_t i = (ch - (size_t)(s->frames % ch)) % ch; i < n && t->len < t->cap; i += ch) {
+        float v = x[i];
+        if (s->format != FMT_F32) {
+            v *= k;
+            if (v > full) v = full;
+            if (v < -full) v = -full;
+            v = (float)lrintf(v) / k;
+        }
+        t->x[t->len++] = v;
+    }
+}
+
+int sink_write(sample_sink *s, const float *x, size_t n)
+{
+    STAT_BEGIN();
+    if (s->tap) sink_tap(s, x, n);
+    if (s->map) {
+        int ok = sink_write_mapped(s, x, n);
+        STAT_END(STAT_SINK, n);
+        return ok;
+    }
+    for (size_t i = 0; i < n; ) {
+        size_t k = (n - i < SINK_CHUNK) ? n - i : SINK_CHUNK;
+        size_t bytes = sink_convert(s, x + i, k, s->buf);
+        if (fwrite(s->buf, 1, bytes, s->fp) != bytes) {
+            perror(s->path);
+            STAT_END(STAT_SINK, i);
+            return 0;
+        }
+        s->frames += k;
+        i += k;
+    }
+    STAT_END(STAT_SINK, n);
+    return 1;
+}
+
+#if WAVEGEN_FIXED_POINT
+// Writes samples that are already signed 16-bit; only valid for FMT_S16 sinks
+int sink_write_q15(sample_sink *s, const int16_t *x, size_t n)
+{
+    STAT_BEGIN();
+    for (size_t i = 0; s->tap && i < n && s->tap->len < s->tap->cap; i++)
+        s->tap->x[s->tap->len++] = (float)x[i] / (32767.0f / s->fullscale);
+    if (s->map && s->frames + n > s->frames_hint) {
+        fprintf(stderr, "%s: more samples than the mapped size\n", s->path);
+        STAT_END(STAT_SINK, 0);
+        return 0;
+    }
+    for (size_t i = 0; i < n; ) {
+        size_t k = (n - i < SINK_CHUNK) ? n - i : SINK_CHUNK;
+        unsigned char *dst = s->map ? s->map + s->data_off + 2 * (size_t)s->frames : s->buf;
+        for (size_t j = 0; j < k; j++) put_le16(dst + 2 * j, (uint32_t)(uint16_t)x[i + j]);
+        if (s->map) {
+            s->frames += k;
+            i += k;
+            sink_sync(s, 0);
+            continue;
+        }
+        if (fwrite(s->buf, 1, 2 * k, s->fp) != 2 * k) {
+            perror(s->path);
+            STAT_END(STAT_SINK, i);
+            return 0;
+        }
+        s->frames += k;
+        i += k;
+    }
+    STAT_END(STAT_SINK, n);
+    return 1;
+}
+#endif
+
+// Flushes and closes; rewrites the WAV header if fewer/more samples arrived than announced
+int sink_close(sample_sink *s)
+{
+    int ok = 1;
+    if (s->map) {
+        // A short run (error or Ctrl-C) trims the file and fixes the header
+        sink_sync(s, 1);
+        if (s->wav && s->frames != s->frames_hint)
+            wav_header(s->map, s->format, s->rate, s->channels, s->frames);
+        if (munmap(s->map, s->map_len) != 0) ok = 0;
+        if (ok && s->frames != s->frames_hint &&
+            ftruncate(s->fd, (off_t)(s->data_off + (size_t)s->frames * (size_t)sink_sample_bytes(s->format))) != 0)
+            ok = 0;
+        if (close(s->fd) != 0) ok = 0;
+        if (!ok) perror(s->path);
+        s->map = NULL;
+        return ok;
+    }
+    if (!s->fp) return 0;
+
+    if (s->wav && s->frames != s->frames_hint && s->fp != stdout && fseek(s->fp, 0L, SEEK_SET) == 0) {
+        unsigned char h[WAV_HEADER_MAX];
+        size_t len = wav_header(h, s->format, s->rate, s->channels, s->frames);
+        if (fwrite(h, 1, len, s->fp) != len) ok = 0;
+    }
+    if (s->fp != stdout) {
+        if (fclose(s->fp) != 0) ok = 0;
+    } else if (fflush(s->fp) != 0) {
+        ok = 0;
+    }
+    if (!ok) perror(s->path);
+    s->fp = NULL;
+    s->buf = NULL;
+    return ok;
+}
+
@@ -0,0 +1,98 @@
+/*
+   wavegen_io.h
+   Waveform Generator host layer (libwavegen)
+
+   The parts of the library that need an operating system: binary and WAV
+   output sinks, AWG tables read from files, ASCII plots on stdout and the
+   diagnostic reports. Everything here sits on top of wavegen.h; a
+   firmware build links the core alone.
+*/
+
+#ifndef WAVEGEN_IO_H
+#define WAVEGEN_IO_H
+
+#include <stdio.h>
+
+#include "wavegen.h"
+
+/* ASCII plots */
+#define DEFAULT_SAMPLES 100   // Resolution for the visual ASCII plot
+#define ASCII_ROWS 21         // Height of the ASCII graph (odd number helps with center line)
+#define ASCII_MAX_COLS 256    // Largest plot print_ascii_from_yvals draws
+#define ASCII_MAX_ROWS 64
+
+void print_ascii_from_yvals(const float *yvals, int cols, int rows, float amp);
+
+// Scratch reporting: install arena_print_failure as a context's on_fail
+// hook to hear about every request that did not fit
+void arena_print_failure(const arena *a, size_t bytes);
+void arena_report(const arena *a, FILE *fp);
+
+/* Binary output sinks: samples are converted into one large byte buffer
+   and written with a single fwrite per block. A mapped sink instead sizes
+   the file up front and converts (or renders, see sink_direct) straight
+   into the page cache */
+enum { FMT_F32 = 1, FMT_S16 = 2, FMT_S24 = 3 };
+
+typedef struct {
+    float *x;              // Channel 0 as the sink stored it (PCM read back as volts)
+    size_t len, cap;
+} sample_tap;
+
+#define SINK_CHUNK 65536  // Samples converted per fwrite (sink_open's buffer holds 4 bytes each)
+
+typedef struct {
+    FILE *fp;
+    const char *path;
+    int format;            // FMT_*
+    int wav;               // 1 = RIFF/WAVE header in front of the samples
+    double rate;
+    int channels;          // Interleaved channels per frame (WAV header)
+    float fullscale;       // Volts mapped to PCM full scale
+    uint64_t frames;       // Samples written so far, all channels
+    uint64_t frames_hint;  // Sample count written into the WAV header up front
+    unsigned char *buf;    // Conversion buffer, SINK_CHUNK samples
+    unsigned char *map;    // Mapped file, NULL for stdio output
+    size_t map_len;        // Header plus frames_hint samples
+    size_t data_off;       // Bytes of header in front of the samples
+    size_t synced;         // Bytes already handed to msync
+    int fd;                // Descriptor behind map
+    sample_tap *tap;       // Keeps the first samples for --analyze, NULL = off
+} sample_sink;
+
+int sink_open(wavegen_ctx *ctx, sample_sink *s, const char *path, int format, int wav,
+              double rate, int channels, float fullscale, uint64_t frames_hint);
+int sink_open_mapped(sample_sink *s, const char *path, int format, int wav,
+                     double rate, int channels, float fullscale, uint64_t frames);
+float *sink_direct(sample_sink *s, size_t n);
+int sink_write(sample_sink *s, const float *x, size_t n);
+int sink_close(sample_sink *s);
+#if WAVEGEN_FIXED_POINT
+int sink_write_q15(sample_sink *s, const int16_t *x, size_t n);
+#endif
+
+void put_le16(unsigned char *p, uint32_t v);
+void put_le32(unsigned char *p, uint32_t v);
+
+// AWG period from a file: raw float32, .csv/.txt numbers or a WAV
+int awg_load(wavegen_ctx *ctx, awg_table *t, const char *path, int interp, int mipmap);
+void awg_unload(awg_table *t);
+
+// Diagnostics that print their findings on stdout
+void sine_lut_report(wavegen_ctx *ctx);
+#if WAVEGEN_FIXED_POINT
+int q15_self_check(wavegen_ctx *ctx);
+#endif
+
+// Host side of the instrumentation: SIGUSR1 asks for a dump, which the
+// render loops serve between blocks through STATS_POLL(arena)
+#if WAVEGEN_STATS
+void stats_watch_signal(void);
+void stats_dump(FILE *fp, const arena *a);
+void stats_poll(const arena *a);
+#define STATS_POLL(a) stats_poll(a)
+#else
+#define STATS_POLL(a) ((void)0)
+#endif
+
+#endif /* WAVEGEN_IO_H */
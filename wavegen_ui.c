@@ -0,0 +1,831 @@
+/*
+   wavegen_ui.c
+   Waveform Generator: interactive menus
+
+   A simple tool to generate waves (Sine, Square, Triangle, Sawtooth,
+   or an arbitrary period loaded from a file) and apply modulations
+   (AM, FM, PWM), driven from a menu on the terminal. Batch rendering
+   lives in wavegen-cli, the timing harness in wavegen-bench; all three
+   link libwavegen.a (see the Makefile).
+
+   usage: wavegen [--plot-size WxH] [--quality naive|blep]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "wavegen_io.h"
+
+#define TABLE_SAMPLES 8       // Just show a few points for the data table output
+
+/* Everything one menu session owns: the library context with its scratch
+   arena, the settings the menus edit and the plot buffers. */
+typedef struct {
+    wavegen_ctx ctx;
+    wave_settings settings;
+    awg_table awg;                 // Table of the current menu action; lives in the arena
+    int plot_cols, plot_rows;
+    float plot_yvals[ASCII_MAX_COLS];  // Shared sample buffer for every plot
+    wave_cache plot_cache[6];      // One cached period per waveform type
+    float plot_cache_buf[6][ASCII_MAX_COLS];
+} ui_session;
+
+/* Menu declarations */
+void main_menu(ui_session *ui);
+int get_user_input(void);
+void select_menu_item(ui_session *ui, int input);
+void print_main_menu(void);
+void print_modulation_menu(void);
+void print_sine_menu(ui_session *ui);
+void print_square_menu(ui_session *ui);
+void print_triangle_menu(ui_session *ui);
+void print_sawtooth_menu(ui_session *ui);
+void print_awg_menu(ui_session *ui);
+int go_back_to_main(void);
+
+/* Helpers */
+void flush_line(void);
+int is_integer(const char *num);
+int set_plot_size(ui_session *ui, int cols, int rows);
+
+/* Actions */
+void menu_item_1(ui_session *ui);
+void menu_item_2(ui_session *ui);
+void menu_item_3(ui_session *ui);
+void menu_item_4(ui_session *ui);
+void menu_item_5(ui_session *ui);
+
+/* Configuration */
+void sine(ui_session *ui);
+void square(ui_session *ui);
+void triangle(ui_session *ui);
+void sawtooth(ui_session *ui);
+int awg(ui_session *ui);
+
+/* Plotting */
+void sine_plot(ui_session *ui);
+void square_plot(ui_session *ui);
+void triangle_plot(ui_session *ui);
+void sawtooth_plot(ui_session *ui);
+void awg_plot(ui_session *ui);
+
+/* Modulation */
+void modulation_prompt(ui_session *ui, int waveform_type);
+void modulation_menu_and_run(ui_session *ui, int waveform_type);
+void run_AM(ui_session *ui, int waveform_type);
+void run_FM(ui_session *ui, int waveform_type);
+void run_PWM(ui_session *ui, int waveform_type);
+void run_PM(ui_session *ui, int waveform_type);
+void show_modulation(ui_session *ui, const char *name, int mod_type, int waveform_type,
+                     const mod_params *mod, float period, float plot_amp);
+
+static _Alignas(ARENA_ALIGN) unsigned char scratch_mem[WAVEGEN_ARENA_BYTES];
+static ui_session session;  // Too large for the stack with its plot caches
+
+static void print_ui_usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --plot-size WxH ASCII plot size (max %dx%d, default %dx%d)\n"
+        "  --quality Q     naive | blep (band-limited square/triangle/sawtooth edges)\n"
+        "batch rendering: wavegen-cli --help\n",
+        prog, ASCII_MAX_COLS, ASCII_MAX_ROWS, DEFAULT_SAMPLES, ASCII_ROWS);
+}
+
+int main(int argc, char const *argv[]) {
+    ui_session *ui = &session;
+
+    // Standard startup
+    wavegen_init();
+#if WAVEGEN_STATS
+    stats_watch_signal();
+#endif
+    wavegen_ctx_init(&ui->ctx, scratch_mem, sizeof(scratch_mem));
+    ui->ctx.scratch.on_fail = arena_print_failure;
+    wave_settings_init(&ui->settings);
+    ui->plot_cols = DEFAULT_SAMPLES;
+    ui->plot_rows = ASCII_ROWS;
+
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ok = 1;
+
+        if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+            print_ui_usage(argv[0]);
+            return 0;
+        }
+        if (!val) {
+            fprintf(stderr, "%s: missing value for %s\n", argv[0], opt);
+            return 2;
+        }
+
+        if (strcmp(opt, "--plot-size") == 0) {
+            int w = 0, h = 0;
+            ok = sscanf(val, "%dx%d", &w, &h) == 2 && set_plot_size(ui, w, h);
+        }
+        else if (strcmp(opt, "--quality") == 0) {
+            if (strcmp(val, "naive") == 0) ui->settings.bandlimited = 0;
+            else if (strcmp(val, "blep") == 0) ui->settings.bandlimited = 1;
+            else ok = 0;
+        }
+        else {
+            fprintf(stderr, "%s: unknown option %s\n", argv[0], opt);
+            print_ui_usage(argv[0]);
+            return 2;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "%s: bad value '%s' for %s\n", argv[0], val, opt);
+            return 2;
+        }
+        i++;
+    }
+
+    main_menu(ui);
+    return 0;
+}
+
+/* ---------- Menu System ---------- */
+
+/* The UI is a flat state machine: each pass through the loop handles one
+   screen and picks the next state, so nothing recurses and the stack depth
+   stays the same no matter how long the session runs. */
+typedef enum {
+    UI_MAIN_MENU,  // Show the waveform menu and read a choice
+    UI_RUN_ITEM,   // Configure, plot and optionally modulate the chosen wave
+    UI_WAIT_BACK,  // Wait for 'b' before showing the menu again
+    UI_EXIT        // Input closed
+} ui_state;
+
+void main_menu(ui_session *ui) {
+    ui_state state = UI_MAIN_MENU;
+    int item = 0;
+
+    while (state != UI_EXIT) {
+        switch (state) {
+            case UI_MAIN_MENU:
+                arena_reset(&ui->ctx.scratch);  // Nothing outlives one menu action
+                print_main_menu();
+                item = get_user_input();
+                state = item ? UI_RUN_ITEM : UI_EXIT;
+                break;
+            case UI_RUN_ITEM:
+                select_menu_item(ui, item);
+                state = UI_WAIT_BACK;
+                break;
+            case UI_WAIT_BACK:
+                STATS_POLL(&ui->ctx.scratch);
+                state = go_back_to_main() ? UI_MAIN_MENU : UI_EXIT;
+                break;
+            default:
+                state = UI_EXIT;
+                break;
+        }
+    }
+}
+
+// Discard the rest of the current line; never blocks past end of input
+void flush_line(void) {
+    int c;
+    while ((c = getchar()) != '\n' && c != EOF) { }
+}
+
+// Robust input handling to prevent crashing on bad input.
+// Returns the menu item, or 0 once the input is closed.
+int get_user_input(void) {
+    int input = 0;
+    char input_string[100];
+    int valid_input = 0;
+    int menu_items = 5;
+
+    do {
+        printf("\nSelect a waveform you'd like to generate (1-%d): ", menu_items);
+        
+        // Read string first to validate format
+        int got = scanf("%99s", input_string);
+        if (got == EOF) return 0; // Input closed, leave the menu loop
+        if (got != 1) {
+            flush_line(); // Flush input buffer if scanf failed hard
+            printf("Enter an integer!\n");
+            continue;
+        }
+
+        valid_input = is_integer(input_string);
+        if (!valid_input) {
+            printf("Enter an integer!\n");
+        } else {
+            input = atoi(input_string);
+            // Bounds check
+            if (input >= 1 && input <= menu_items) valid_input = 1;
+            else {
+                printf("Invalid menu item!\n");
+                valid_input = 0;
+            }
+        }
+    } while (!valid_input);
+
+    return input;
+}
+
+void select_menu_item(ui_session *ui, int input) {
+    switch (input) {
+        case 1: menu_item_1(ui); break;
+        case 2: menu_item_2(ui); break;
+        case 3: menu_item_3(ui); break;
+        case 4: menu_item_4(ui); break;
+        case 5: menu_item_5(ui); break;
+        default:
+            printf("\nWrong number to select\n");
+            break;
+    }
+}
+
+void print_main_menu(void) {
+    printf("\n----------- waveform generator -----------\n");
+    printf("|                                       |\n");
+    printf("|   1. sine                              |\n");
+    printf("|   2. square                            |\n");
+    printf("|   3. triangle                          |\n");
+    printf("|   4. sawtooth                          |\n");
+    printf("|   5. arbitrary (table from a file)     |\n");
+    printf("-----------------------------------------\n");
+}
+
+void print_sine_menu(ui_session *ui) {
+    printf("\n----------- sine settings -----------\n");
+    printf("| 1. frequency: %.6f Hz               |\n", ui->settings.wave[1].freq);
+    printf("| 2. amplitude: %.6f V                |\n", ui->settings.wave[1].amp);
+    printf("| 3. phase:     %.6f rad              |\n", ui->settings.wave[1].phase);
+    printf("-------------------------------------\n");
+}
+
+void print_square_menu(ui_session *ui) {
+    printf("\n----------- square settings ---------\n");
+    printf("| 1. frequency: %.6f Hz               |\n", ui->settings.wave[2].freq);
+    printf("| 2. amplitude: %.6f V                |\n", ui->settings.wave[2].amp);
+    printf("| 3. duty cycle: %.6f                  |\n", ui->settings.wave[2].duty);
+    printf("-------------------------------------\n");
+}
+
+void print_triangle_menu(ui_session *ui) {
+    printf("\n---------- triangle settings ---------\n");
+    printf("| 1. frequency: %.6f Hz               |\n", ui->settings.wave[3].freq);
+    printf("| 2. amplitude: %.6f V                |\n", ui->settings.wave[3].amp);
+    printf("-------------------------------------\n");
+}
+
+void print_sawtooth_menu(ui_session *ui) {
+    printf("\n---------- sawtooth settings ---------\n");
+    printf("| 1. jump amplitude: %.6f V           |\n", ui->settings.wave[4].amp);
+    printf("| 2. slope:          %.6f             |\n", ui->settings.slope);
+    printf("-------------------------------------\n");
+}
+
+void print_awg_menu(ui_session *ui) {
+    static const char *const interp[] = { "", "nearest", "linear", "cubic" };
+    printf("\n------------ AWG settings ------------\n");
+    printf("| 1. table file: %s\n", ui->settings.awg_path[0] ? ui->settings.awg_path : "(none)");
+    printf("| 2. frequency: %.6f Hz               |\n", ui->settings.wave[5].freq);
+    printf("| 3. amplitude: %.6f V                |\n", ui->settings.wave[5].amp);
+    printf("| 4. interpolation: %-8s            |\n", interp[ui->settings.awg_interp]);
+    printf("| 5. mipmaps: %-3s                      |\n", ui->settings.awg_mipmap ? "on" : "off");
+    printf("-------------------------------------\n");
+}
+
+// Returns 1 once the user types 'b', 0 if the input is closed
+int go_back_to_main(void) {
+    char input[100];
+    // Keep nagging the user until they type 'b'
+    do {
+        printf("\nEnter 'b' or 'B' to go back to main menu: ");
+        int got = scanf("%99s", input);
+        if (got == EOF) return 0;
+        if (got != 1) {
+            flush_line(); // Clean garbage
+            continue;
+        }
+    } while (input[0] != 'b' && input[0] != 'B');
+    return 1;
+}
+
+// Check if string contains only digits (plus optional sign)
+int is_integer(const char *num) {
+    if (!num || !*num) return 0;
+    int start = 0;
+    if (num[0] == '+' || num[0] == '-') {
+        start = 1;
+        if (!num[start]) return 0; // " +" is not a number
+    }
+    for (int i = start; num[i] != '\0'; i++) {
+        if (!isdigit((unsigned char)num[i])) return 0;
+    }
+    return 1;
+}
+
+/* ---------- Configuration Handlers ---------- */
+
+// Invalidates every cached period if the setter changed anything
+static void note_changes(ui_session *ui, const float *before, const float *after, size_t n)
+{
+    if (memcmp(before, after, n * sizeof(float)) != 0) ui->ctx.cache_version++;
+}
+
+void sine(ui_session *ui)
+{
+    const float before[3] = { ui->settings.wave[1].freq, ui->settings.wave[1].amp, ui->settings.wave[1].phase };
+
+    printf("\ninput frequency (Hz): ");
+    if (scanf("%f", &ui->settings.wave[1].freq) != 1) ui->settings.wave[1].freq = 1.0f; // Default if fail
+    print_sine_menu(ui);
+
+    printf("\ninput amplitude (V): ");
+    if (scanf("%f", &ui->settings.wave[1].amp) != 1) ui->settings.wave[1].amp = 1.0f;
+    print_sine_menu(ui);
+
+    flush_line(); // Clean buffer before reading line
+
+    printf("\ninput phase (rad). Examples: 1.57    3.14/2    90deg    d:90    r:1.57\n");
+    char buf[128] = {0};
+    if (!fgets(buf, sizeof(buf), stdin)) ui->settings.wave[1].phase = 0.0f;
+    else {
+        float rad = 0.0f;
+        // Try to parse the smart phase string
+        if (parse_phase_input_to_rad(buf, &rad)) ui->settings.wave[1].phase = rad;
+        else { 
+            printf("Failed to parse phase, set to 0.\n"); 
+            ui->settings.wave[1].phase = 0.0f; 
+        }
+    }
+    print_sine_menu(ui);
+
+    const float after[3] = { ui->settings.wave[1].freq, ui->settings.wave[1].amp, ui->settings.wave[1].phase };
+    note_changes(ui, before, after, 3);
+}
+
+void square(ui_session *ui)
+{
+    const float before[3] = { ui->settings.wave[2].freq, ui->settings.wave[2].amp, ui->settings.wave[2].duty };
+
+    printf("\ninput frequency (Hz): ");
+    if (scanf("%f", &ui->settings.wave[2].freq) != 1) ui->settings.wave[2].freq = 1.0f;
+    print_square_menu(ui);
+
+    printf("\ninput amplitude (V): ");
+    if (scanf("%f", &ui->settings.wave[2].amp) != 1) ui->settings.wave[2].amp = 1.0f;
+    print_square_menu(ui);
+
+    printf("\ninput duty cycle (0..1): ");
+    if (scanf("%f", &ui->settings.wave[2].duty) != 1) ui->settings.wave[2].duty = 0.5f;
+    // Clamp duty cycle
+    if (ui->settings.wave[2].duty < 0.0f) ui->settings.wave[2].duty = 0.0f;
+    if (ui->settings.wave[2].duty > 1.0f) ui->settings.wave[2].duty = 1.0f;
+    print_square_menu(ui);
+
+    const float after[3] = { ui->settings.wave[2].freq, ui->settings.wave[2].amp, ui->settings.wave[2].duty };
+    note_changes(ui, before, after, 3);
+}
+
+void triangle(ui_session *ui)
+{
+    const float before[2] = { ui->settings.wave[3].freq, ui->settings.wave[3].amp };
+
+    printf("\ninput frequency (Hz): ");
+    if (scanf("%f", &ui->settings.wave[3].freq) != 1) ui->settings.wave[3].freq = 1.0f;
+    print_triangle_menu(ui);
+
+    printf("\ninput amplitude (V): ");
+    if (scanf("%f", &ui->settings.wave[3].amp) != 1) ui->settings.wave[3].amp = 1.0f;
+    print_triangle_menu(ui);
+
+    const float after[2] = { ui->settings.wave[3].freq, ui->settings.wave[3].amp };
+    note_changes(ui, before, after, 2);
+}
+
+void sawtooth(ui_session *ui)
+{
+    const float before[2] = { ui->settings.wave[4].amp, ui->settings.slope };
+
+    printf("\ninput jump amplitude (V): ");
+    if (scanf("%f", &ui->settings.wave[4].amp) != 1) ui->settings.wave[4].amp = 1.0f;
+    print_sawtooth_menu(ui);
+
+    printf("\ninput slope: ");
+    if (scanf("%f", &ui->settings.slope) != 1) ui->settings.slope = 1.0f;
+    print_sawtooth_menu(ui);
+
+    const float after[2] = { ui->settings.wave[4].amp, ui->settings.slope };
+    note_changes(ui, before, after, 2);
+}
+
+// Returns 1 with the table loaded, 0 if the file could not be used
+int awg(ui_session *ui)
+{
+    printf("\ninput table file (raw float32, .csv/.txt, or .wav; one period): ");
+    if (scanf("%255s", ui->settings.awg_path) != 1) ui->settings.awg_path[0] = '\0';
+    print_awg_menu(ui);
+
+    printf("\ninput frequency (Hz): ");
+    if (scanf("%f", &ui->settings.wave[5].freq) != 1) ui->settings.wave[5].freq = 1.0f;
+    print_awg_menu(ui);
+
+    printf("\ninput amplitude (V): ");
+    if (scanf("%f", &ui->settings.wave[5].amp) != 1) ui->settings.wave[5].amp = 1.0f;
+    print_awg_menu(ui);
+
+    printf("\ninput interpolation (1 nearest, 2 linear, 3 cubic): ");
+    if (scanf("%d", &ui->settings.awg_interp) != 1) ui->settings.awg_interp = AWG_LINEAR;
+    if (ui->settings.awg_interp < AWG_NEAREST || ui->settings.awg_interp > AWG_CUBIC)
+        ui->settings.awg_interp = AWG_LINEAR;
+    print_awg_menu(ui);
+
+    char yn = 'y';
+    printf("\nuse mipmaps (y/n): ");
+    if (scanf(" %c", &yn) != 1) flush_line();
+    ui->settings.awg_mipmap = yn != 'n' && yn != 'N';
+    print_awg_menu(ui);
+
+    // Loading bumps the cache version: the same arena slot may hold a new table
+    if (!ui->settings.awg_path[0] ||
+        !awg_load(&ui->ctx, &ui->awg, ui->settings.awg_path, ui->settings.awg_interp, ui->settings.awg_mipmap)) {
+        printf("\nCould not load a table from '%s'\n", ui->settings.awg_path);
+        return 0;
+    }
+    ui->settings.wave[5].table = &ui->awg;
+    return 1;
+}
+
+/* ---------- ASCII Plot Size ---------- */
+
+// Returns 0 if the size is outside what print_ascii_from_yvals draws
+int set_plot_size(ui_session *ui, int cols, int rows)
+{
+    if (cols < 1 || cols > ASCII_MAX_COLS || rows < 1 || rows > ASCII_MAX_ROWS) return 0;
+    ui->plot_cols = cols;
+    ui->plot_rows = rows;
+    return 1;
+}
+
+/* ---------- Modified Plotting Functions ---------- */
+
+// One period of the waveform at the plot resolution; re-rendered only after
+// a setter changed something or the plot size changed
+static const float *plot_period(ui_session *ui, int waveform_type, const wave_params *p, float step, int n)
+{
+    if (!ui->plot_cache[waveform_type].buf)
+        wave_cache_init(&ui->plot_cache[waveform_type], ui->plot_cache_buf[waveform_type], ASCII_MAX_COLS);
+    const float *y = wave_cache_get(&ui->ctx, &ui->plot_cache[waveform_type], waveform_type, p,
+                                    step, (size_t)n, (size_t)n);
+    if (y) return y;
+    render_waveform_block(waveform_type, p, 0.0f, step, ui->plot_yvals, (size_t)n);
+    return ui->plot_yvals;
+}
+
+void sine_plot(ui_session *ui){
+    if (ui->settings.wave[1].freq <= 0.0f) {
+        printf("\nFrequency must be > 0!\n");
+        return;
+    }
+    
+    // Part 1: Show a small table of values (Requirements said 8 samples)
+    printf("\n========== Sine Wave Table (One Period, 8 Samples) ==========\n");
+    printf("Frequency = %.6f Hz, Amplitude = %.6f, Phase = %.6f rad\n\n",
+           ui->settings.wave[1].freq, ui->settings.wave[1].amp, ui->settings.wave[1].phase);
+    printf("t(sec)\t\ty\n");
+    
+    wave_params wp;
+    wave_settings_get(&ui->settings, 1, &wp);
+
+    float period = 1.0f / ui->settings.wave[1].freq;
+    float table_step = period / (float)TABLE_SAMPLES;
+    float table[TABLE_SAMPLES];
+    render_waveform_block(1, &wp, 0.0f, table_step, table, TABLE_SAMPLES);
+    
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * table_step, table[i]);
+    }
+
+    // Part 2: Generate data for the ASCII plot (Higher resolution)
+    const int N = ui->plot_cols;
+    const int rows = ui->plot_rows;
+    float plot_step = period / (float)N;
+    // The phase is applied inside the renderer, so the plot starts at t = 0
+    const float *yval = plot_period(ui, 1, &wp, plot_step, N);
+
+    printf("\n========== Sine Wave ASCII Plot ==========\n");
+    print_ascii_from_yvals(yval, N, rows, ui->settings.wave[1].amp);
+    printf("===========================================\n");
+
+    // Ask for Modulation
+    modulation_prompt(ui, 1);
+}
+
+void square_plot(ui_session *ui)
+{
+    if (ui->settings.wave[2].freq <= 0.0f) { printf("\nFrequency must be > 0!\n"); return; }
+
+    float period = 1.0f / ui->settings.wave[2].freq;
+
+    // Table output
+    printf("\n\n========== Square Wave Table (One Period, 8 Samples) ==========\n");
+    printf("Frequency = %.6f Hz, Amplitude = %.6f, Duty = %.6f\n\n",
+           ui->settings.wave[2].freq, ui->settings.wave[2].amp, ui->settings.wave[2].duty);
+    printf("t(sec)\t\ty\n");
+    
+    wave_params wp;
+    wave_settings_get(&ui->settings, 2, &wp);
+
+    float table_step = period / (float)TABLE_SAMPLES;
+    float table[TABLE_SAMPLES];
+    render_waveform_block(2, &wp, 0.0f, table_step, table, TABLE_SAMPLES);
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * table_step, table[i]);
+    }
+
+    // Plot output
+    const int N = ui->plot_cols;
+    float plot_step = period / (float)N;
+    const float *yval = plot_period(ui, 2, &wp, plot_step, N);
+
+    printf("\n========== Square Wave ASCII Plot ==========\n");
+    print_ascii_from_yvals(yval, N, ui->plot_rows, ui->settings.wave[2].amp);
+    printf("===============================================\n");
+
+    modulation_prompt(ui, 2);
+}
+
+void triangle_plot(ui_session *ui)
+{
+    if (ui->settings.wave[3].freq <= 0.0f) { printf("\nFrequency must be > 0!\n"); return; }
+
+    float period = 1.0f / ui->settings.wave[3].freq;
+
+    // Table
+    printf("\n========== Triangle Wave Table (One Period, 8 Samples) ==========\n");
+    printf("Frequency = %.6f Hz, Amplitude = %.6f\n\n", ui->settings.wave[3].freq, ui->settings.wave[3].amp);
+    printf("t(sec)\t\ty\n");
+    
+    wave_params wp;
+    wave_settings_get(&ui->settings, 3, &wp);
+
+    float table_step = period / (float)TABLE_SAMPLES;
+    float table[TABLE_SAMPLES];
+    render_waveform_block(3, &wp, 0.0f, table_step, table, TABLE_SAMPLES);
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * table_step, table[i]);
+    }
+
+    // Plot
+    const int N = ui->plot_cols;
+    float plot_step = period / (float)N;
+    const float *yval = plot_period(ui, 3, &wp, plot_step, N);
+
+    printf("\n========== Triangle Wave ASCII Plot ==========\n");
+    print_ascii_from_yvals(yval, N, ui->plot_rows, ui->settings.wave[3].amp);
+    printf("===============================================\n");
+
+    modulation_prompt(ui, 3);
+}
+
+void sawtooth_plot(ui_session *ui)
+{
+    if (ui->settings.wave[4].freq <= 0.0f) { printf("\nFrequency must be > 0!\n"); return; }
+
+    float period = 1.0f / ui->settings.wave[4].freq;
+
+    // Table
+    printf("\n\n========== Sawtooth Wave Table (One Period, 8 Samples) ==========\n");
+    printf("Frequency = %.6f Hz, Jump Amp = %.6f, Slope = %.6f\n\n", ui->settings.wave[4].freq, ui->settings.wave[4].amp, ui->settings.slope);
+    printf("t(sec)\t\ty\n");
+    
+    wave_params wp;
+    wave_settings_get(&ui->settings, 4, &wp);
+
+    float table_step = period / (float)TABLE_SAMPLES;
+    float table[TABLE_SAMPLES];
+    render_waveform_block(4, &wp, 0.0f, table_step, table, TABLE_SAMPLES);
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * table_step, table[i]);
+    }
+
+    // Plot
+    const int N = ui->plot_cols;
+    float plot_step = period / (float)N;
+    const float *yval = plot_period(ui, 4, &wp, plot_step, N);
+
+    printf("\n========== Sawtooth Wave ASCII Plot ==========\n");
+    print_ascii_from_yvals(yval, N, ui->plot_rows, ui->settings.wave[4].amp);
+    printf("===============================================\n");
+
+    modulation_prompt(ui, 4);
+}
+
+void awg_plot(ui_session *ui)
+{
+    if (ui->settings.wave[5].freq <= 0.0f) { printf("\nFrequency must be > 0!\n"); return; }
+
+    float period = 1.0f / ui->settings.wave[5].freq;
+
+    // Table
+    printf("\n========== AWG Table (One Period, 8 Samples) ==========\n");
+    printf("File = %s (%zu entries, %d levels), Frequency = %.6f Hz, Amplitude = %.6f\n\n",
+           ui->settings.awg_path, ui->awg.len[0], ui->awg.levels,
+           ui->settings.wave[5].freq, ui->settings.wave[5].amp);
+    printf("t(sec)\t\ty\n");
+
+    wave_params wp;
+    wave_settings_get(&ui->settings, 5, &wp);
+
+    float table_step = period / (float)TABLE_SAMPLES;
+    float table[TABLE_SAMPLES];
+    render_waveform_block(5, &wp, 0.0f, table_step, table, TABLE_SAMPLES);
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * table_step, table[i]);
+    }
+
+    // Plot
+    const int N = ui->plot_cols;
+    float plot_step = period / (float)N;
+    const float *yval = plot_period(ui, 5, &wp, plot_step, N);
+
+    printf("\n========== AWG ASCII Plot ==========\n");
+    print_ascii_from_yvals(yval, N, ui->plot_rows, ui->settings.wave[5].amp);
+    printf("===============================================\n");
+
+    // The loaded table can also be the modulating signal
+    modulation_prompt(ui, 5);
+}
+
+/* ---------- Wrappers to glue menu to logic ---------- */
+
+void menu_item_1(ui_session *ui) {
+    printf("\n>> sine\n");
+    sine(ui);
+    sine_plot(ui);
+}
+
+void menu_item_2(ui_session *ui) {
+    printf("\n>> square\n");
+    square(ui);
+    square_plot(ui);
+}
+
+void menu_item_3(ui_session *ui) {
+    printf("\n>> triangle\n");
+    triangle(ui);
+    triangle_plot(ui);
+}
+
+void menu_item_4(ui_session *ui) {
+    printf("\n>> sawtooth\n");
+    sawtooth(ui);
+    sawtooth_plot(ui);
+}
+
+void menu_item_5(ui_session *ui) {
+    printf("\n>> arbitrary waveform\n");
+    if (awg(ui)) awg_plot(ui);
+    // The table's memory goes back to the arena with this menu action
+    awg_unload(&ui->awg);
+    ui->settings.wave[5].table = NULL;
+}
+
+/* ---------- Modulation Logic ---------- */
+
+void print_modulation_menu(void)
+{
+    printf("\n----------- modulation menu -----------\n");
+    printf("| 1. AM (Amplitude Modulation)        |\n");
+    printf("| 2. FM (Frequency Modulation)        |\n");
+    printf("| 3. PWM (Pulse Width Modulation)     |\n");
+    printf("| 4. PM (Phase Modulation)            |\n");
+    printf("---------------------------------------\n");
+}
+
+void modulation_prompt(ui_session *ui, int waveform_type)
+{
+    char yn = 'n';
+    printf("\nDo you want to apply modulation to this waveform? (y/n): ");
+    
+    if (scanf(" %c", &yn) != 1) { 
+        flush_line();
+    }
+    
+    if (yn == 'y' || yn == 'Y') {
+        modulation_menu_and_run(ui, waveform_type);
+    }
+}
+
+void modulation_menu_and_run(ui_session *ui, int waveform_type)
+{
+    print_modulation_menu();
+    int choice = 0;
+    printf("\nSelect modulation type (1-4): ");
+    if (scanf("%d", &choice) != 1) {
+        flush_line();
+        printf("Invalid input\n");
+        return;
+    }
+    switch (choice) {
+        case 1: run_AM(ui, waveform_type); break;
+        case 2: run_FM(ui, waveform_type); break;
+        case 3: run_PWM(ui, waveform_type); break;
+        case 4: run_PM(ui, waveform_type); break;
+        default: printf("Invalid modulation choice\n"); break;
+    }
+}
+
+// Prints the 8-sample table and the ASCII plot over one carrier period
+void show_modulation(ui_session *ui, const char *name, int mod_type, int waveform_type,
+                     const mod_params *mod, float period, float plot_amp)
+{
+    wave_params wp;
+    wave_settings_get(&ui->settings, waveform_type, &wp);
+    mod_params mp = *mod;
+
+    // --- Table Output ---
+    printf("\n=== %s Sample Table (One Period, 8 Samples) ===\n", name);
+    printf("t(sec)\t\ty\n");
+    float table[TABLE_SAMPLES];
+    mp.t0 = 0.0f;
+    mp.dt = period / (float)TABLE_SAMPLES;
+    modulate_block(mod_type, waveform_type, &wp, &mp, table, TABLE_SAMPLES);
+    for (int i = 0; i < TABLE_SAMPLES; i++) {
+        printf("%.6f\t%.6f\n", i * mp.dt, table[i]);
+    }
+
+    // --- Plot Data ---
+    const int N = ui->plot_cols;
+    float *y = ui->plot_yvals;
+    mp.dt = period / (float)N;
+    modulate_block(mod_type, waveform_type, &wp, &mp, y, (size_t)N);
+
+    printf("\n=== %s ASCII Plot ===\n", name);
+    print_ascii_from_yvals(y, N, ui->plot_rows, plot_amp);
+    printf("=========================================\n");
+}
+
+/* ---------- Modulation Implementations ---------- */
+
+void run_AM(ui_session *ui, int waveform_type)
+{
+    printf("\n=== AM Modulation ===\n");
+    float Ac = 1.0f, fc = 1.0f, m = 0.5f;
+    // Get parameters with lazy flush
+    printf("Carrier amplitude Ac: "); if (scanf("%f", &Ac) != 1) { flush_line(); }
+    printf("Carrier frequency fc (Hz): "); if (scanf("%f", &fc) != 1) { flush_line(); }
+    printf("Modulation index m (0..1 recommended): "); if (scanf("%f", &m) != 1) { flush_line(); }
+
+    float period = (fc > 0.0f) ? 1.0f / fc : 1.0f;
+    mod_params mp = { Ac, fc, m, 0.0f, 0.0f };
+
+    // Pass the peak amplitude so the plot scales correctly
+    show_modulation(ui, "AM", MOD_AM, waveform_type, &mp, period, Ac * (1.0f + fabsf(m)));
+}
+
+void run_FM(ui_session *ui, int waveform_type)
+{
+    printf("\n=== FM Modulation ===\n");
+    float Ac = 1.0f, fc = 1.0f, beta = 1.0f;
+    printf("Carrier amplitude Ac: "); if (scanf("%f", &Ac) != 1) { flush_line(); }
+    printf("Carrier frequency fc (Hz): "); if (scanf("%f", &fc) != 1) { flush_line(); }
+    printf("Modulation index beta (peak deviation / modulating frequency): "); if (scanf("%f", &beta) != 1) { flush_line(); }
+
+    float period = (fc > 0.0f) ? 1.0f / fc : 1.0f;
+    mod_params mp = { Ac, fc, beta, 0.0f, 0.0f };
+
+    show_modulation(ui, "FM", MOD_FM, waveform_type, &mp, period, Ac);
+}
+
+void run_PM(ui_session *ui, int waveform_type)
+{
+    printf("\n=== PM Modulation ===\n");
+    float Ac = 1.0f, fc = 1.0f, beta = 1.0f;
+    printf("Carrier amplitude Ac: "); if (scanf("%f", &Ac) != 1) { flush_line(); }
+    printf("Carrier frequency fc (Hz): "); if (scanf("%f", &fc) != 1) { flush_line(); }
+    printf("Phase deviation beta (radians): "); if (scanf("%f", &beta) != 1) { flush_line(); }
+
+    float period = (fc > 0.0f) ? 1.0f / fc : 1.0f;
+    mod_params mp = { Ac, fc, beta, 0.0f, 0.0f };
+
+    show_modulation(ui, "PM", MOD_PM, waveform_type, &mp, period, Ac);
+}
+
+void run_PWM(ui_session *ui, int waveform_type)
+{
+    printf("\n=== PWM Modulation ===\n");
+    float fpwm = 50.0f, Ac = 1.0f;
+    printf("PWM carrier frequency fpwm (Hz): "); if (scanf("%f", &fpwm) != 1) { flush_line(); }
+    printf("Output amplitude Ac (for high level): "); if (scanf("%f", &Ac) != 1) { flush_line(); }
+
+    float period = (fpwm > 0.0f) ? 1.0f / fpwm : 1.0f;
+    mod_params mp = { Ac, 1.0f / period, 0.0f, 0.0f, 0.0f };
+
+    show_modulation(ui, "PWM", MOD_PWM, waveform_type, &mp, period, Ac);
+}
+